@@ -5,6 +5,7 @@
 #include "catch.hpp"
 
 #include "algorithm.h"
+#include "external_sort.h"
 
 #include <algorithm>
 #include <type_traits>
@@ -12,6 +13,13 @@
 #include <memory>
 #include <random>
 #include <iterator>
+#include <limits>
+#include <sstream>
+#include <list>
+#include <forward_list>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
 
 TEST_CASE("all_of", "[all_of]")
 {
@@ -218,6 +226,54 @@ TEST_CASE("mismatch", "[mismatch]")
    res = STL::mismatch(std::begin(testArr1), std::end(testArr1), std::begin(testArr2), std::end(testArr2));
    REQUIRE(res.first == std::end(testArr1));
    REQUIRE(res.second == std::end(testArr2));
+
+   // mismatch, equal and lexicographical_compare agree with the standard
+   // library for a difference at every position. The values of one differ
+   // from zero in their lowest byte, where every level of the mismatch
+   // kernel the processor runs must stop.
+   auto check = [](auto zero, auto one) {
+      using T = decltype(zero);
+      for (auto n : { 0, 1, 7, 16, 33, 64, 100, 129, 300 }) {
+         std::vector<T> a(n, zero);
+         for (auto i = 0; i <= n; ++i) {
+            auto b = a;
+            if (i < n)
+               b[i] = one;
+            auto res = STL::mismatch(std::begin(a), std::end(a), std::begin(b), std::end(b));
+            REQUIRE(res.first - std::begin(a) == i);
+            REQUIRE(res.second - std::begin(b) == i);
+            REQUIRE(STL::equal(std::begin(a), std::end(a), std::begin(b), std::end(b)) == (i == n));
+            REQUIRE(STL::equal(std::begin(a), std::end(a), std::begin(b)) == (i == n));
+            REQUIRE(STL::lexicographical_compare(std::begin(a), std::end(a), std::begin(b), std::end(b)) ==
+               std::lexicographical_compare(std::begin(a), std::end(a), std::begin(b), std::end(b)));
+            REQUIRE(STL::lexicographical_compare(std::begin(b), std::end(b), std::begin(a), std::end(a)) ==
+               std::lexicographical_compare(std::begin(b), std::end(b), std::begin(a), std::end(a)));
+            REQUIRE(STL::lexicographical_compare(std::begin(a), std::begin(a) + i, std::begin(b), std::end(b)) == (i < n));
+            for (auto level : { STL::simd::isa_level::sse42, STL::simd::isa_level::avx2, STL::simd::isa_level::avx512 }) {
+               auto kernel = STL::simd::mismatch_kernels.resolve(level);
+               if (level <= STL::simd::cpu_isa_level() && kernel)
+                  REQUIRE(kernel(a.data(), b.data(), n * sizeof(T)) == static_cast<std::size_t>(i) * sizeof(T));
+            }
+         }
+      }
+   };
+   check(std::uint8_t{ 0 }, std::uint8_t{ 0xff });
+   check(std::int32_t{ 0 }, std::int32_t{ -1 });
+   check(std::uint64_t{ 0 }, std::uint64_t{ 1 });
+
+   // A shorter range that is a prefix of the other one compares less.
+   std::string s1 = "abc", s2 = "abcd";
+   REQUIRE(STL::lexicographical_compare(std::begin(s1), std::end(s1), std::begin(s2), std::end(s2)));
+   REQUIRE(!STL::lexicographical_compare(std::begin(s2), std::end(s2), std::begin(s1), std::end(s1)));
+   REQUIRE(!STL::lexicographical_compare(std::begin(s1), std::end(s1), std::begin(s1), std::end(s1)));
+   std::list<int> l1{ 1, 2 }, l2{ 1, 2, 0 };
+   REQUIRE(STL::lexicographical_compare(std::begin(l1), std::end(l1), std::begin(l2), std::end(l2)));
+   REQUIRE(!STL::lexicographical_compare(std::begin(l2), std::end(l2), std::begin(l1), std::end(l1)));
+
+   // A std::less of another type may find elements equivalent that differ.
+   std::vector<int> wide1{ 256, 0 }, wide2{ 0, 1 };
+   REQUIRE(STL::lexicographical_compare(std::begin(wide1), std::end(wide1), std::begin(wide2), std::end(wide2), std::less<char>()));
+   REQUIRE(!STL::lexicographical_compare(std::begin(wide1), std::end(wide1), std::begin(wide2), std::end(wide2)));
 }
 
 TEST_CASE("equal", "[equal]")
@@ -278,6 +334,98 @@ TEST_CASE("find", "[find]")
    REQUIRE(STL::find_if_not(std::begin(testArr1), std::end(testArr1), [](const auto &val) { return val == 1; }) == std::begin(testArr1) + 1);
 }
 
+TEST_CASE("simd_find", "[simd_find]")
+{
+   // Matches at every position of ranges long enough for the unrolled loop
+   // and its tails, checked against std::find and std::count, and random
+   // ranges through the kernels of every level the processor runs.
+   auto check = [](auto zero, auto one) {
+      using T = decltype(zero);
+      std::mt19937 gen(23);
+      for (auto n : { 0, 1, 7, 15, 16, 17, 63, 64, 65, 127, 128, 129, 300 }) {
+         std::vector<T> v(n, zero);
+         REQUIRE(STL::find(std::begin(v), std::end(v), one) == std::end(v));
+         REQUIRE(STL::count(std::begin(v), std::end(v), one) == 0);
+         for (auto pos = 0; pos < n; ++pos) {
+            v[pos] = one;
+            REQUIRE(STL::find(std::begin(v), std::end(v), one) == std::begin(v) + pos);
+            REQUIRE(STL::find(v.data() + pos / 2, v.data() + n, one) == v.data() + pos);
+            v[pos] = zero;
+         }
+         for (auto &e : v) {
+            e = gen() % 3 ? zero : one;
+         }
+         REQUIRE(STL::find(std::cbegin(v), std::cend(v), one) == std::find(std::cbegin(v), std::cend(v), one));
+         REQUIRE(STL::count(std::begin(v), std::end(v), one) == std::count(std::begin(v), std::end(v), one));
+         REQUIRE(STL::count(std::begin(v), std::end(v), zero) == std::count(std::begin(v), std::end(v), zero));
+         for (auto level : { STL::simd::isa_level::sse42, STL::simd::isa_level::avx2, STL::simd::isa_level::avx512 }) {
+            auto find = STL::simd::find_kernels<T>.resolve(level);
+            auto count = STL::simd::count_kernels<T>.resolve(level);
+            if (level > STL::simd::cpu_isa_level() || !find || !count)
+               continue;
+            REQUIRE(find(v.data(), v.data() + n, one) == std::find(v.data(), v.data() + n, one));
+            REQUIRE(find(v.data(), v.data() + n, zero) == std::find(v.data(), v.data() + n, zero));
+            REQUIRE(count(v.data(), v.data() + n, one) == static_cast<std::size_t>(std::count(v.data(), v.data() + n, one)));
+         }
+      }
+   };
+   check(std::int8_t{ 0 }, std::int8_t{ -1 });
+   check(std::uint8_t{ 1 }, std::uint8_t{ 200 });
+   check(char{ 'a' }, char{ 'z' });
+   check(std::int16_t{ 0 }, std::int16_t{ -300 });
+   check(std::uint32_t{ 5 }, std::uint32_t{ 0x80000000u });
+   check(std::int64_t{ 0 }, std::int64_t{ -1 });
+   check(1.0f, -2.5f);
+   check(0.5, 1e300);
+
+   // Values are compared as operator== would compare them.
+   std::vector<std::uint8_t> bytes(100, 255);
+   REQUIRE(STL::find(std::begin(bytes), std::end(bytes), -1) == std::end(bytes));
+   REQUIRE(STL::find(std::begin(bytes), std::end(bytes), static_cast<signed char>(-1)) == std::end(bytes));
+   REQUIRE(STL::find(std::begin(bytes), std::end(bytes), 255) == std::begin(bytes));
+   REQUIRE(STL::count(std::begin(bytes), std::end(bytes), 255 + 256) == 0);
+   std::vector<int> ints(100, -1);
+   REQUIRE(STL::count(std::begin(ints), std::end(ints), 0xffffffffu) == 100);
+
+   std::vector<double> reals(50, 0.0);
+   reals[40] = std::numeric_limits<double>::quiet_NaN();
+   REQUIRE(STL::find(std::begin(reals), std::end(reals), reals[40]) == std::end(reals));
+   REQUIRE(STL::count(std::begin(reals), std::end(reals), -0.0) == 49);
+
+   // any_of and none_of stop in the block of the first hit.
+   std::vector<int> values(1000);
+   std::iota(std::begin(values), std::end(values), 0);
+   auto calls = 0;
+   REQUIRE(STL::any_of(std::begin(values), std::end(values), [&calls](int v) { ++calls; return v == 100; }));
+   REQUIRE(calls < 200);
+   REQUIRE(STL::any_of(std::begin(values), std::end(values), [](int v) { return v == 999; }));
+   REQUIRE(!STL::any_of(std::begin(values), std::end(values), [](int v) { return v < 0; }));
+   REQUIRE(STL::none_of(std::begin(values), std::end(values), [](int v) { return v > 999; }));
+   REQUIRE(!STL::none_of(std::begin(values), std::end(values), [](int v) { return v == 998; }));
+   std::list<int> linked(std::begin(values), std::end(values));
+   REQUIRE(STL::any_of(std::begin(linked), std::end(linked), [](int v) { return v == 500; }));
+   REQUIRE(STL::none_of(std::begin(linked), std::end(linked), [](int v) { return v == 1000; }));
+}
+
+TEST_CASE("simd_dispatch", "[simd_dispatch]")
+{
+   using STL::simd::isa_level;
+   for (auto level : { isa_level::scalar, isa_level::sse42, isa_level::avx2, isa_level::avx512 }) {
+      REQUIRE(STL::simd::parse_isa_level(STL::simd::isa_level_name(level)) == level);
+   }
+   REQUIRE(!STL::simd::parse_isa_level("sse9"));
+   REQUIRE(STL::simd::active_isa_level() <= STL::simd::cpu_isa_level());
+
+   // A level without a kernel of its own falls back to the one below it.
+   STL::simd::kernel_table<int (*)()> table;
+   REQUIRE(table.resolve(isa_level::avx512) == nullptr);
+   auto sse42 = +[] { return 1; };
+   table[isa_level::sse42] = sse42;
+   REQUIRE(table.resolve(isa_level::scalar) == nullptr);
+   REQUIRE(table.resolve(isa_level::sse42) == sse42);
+   REQUIRE(table.resolve(isa_level::avx512) == sse42);
+}
+
 TEST_CASE("find_end", "[find_end]")
 {
    int testArr1[] = { 2, 1, 2, 3, 4, 5, 6, 1, 2, 3, 10, 1, 2, 3 };
@@ -296,6 +444,32 @@ TEST_CASE("find_end", "[find_end]")
    REQUIRE(STL::find_end(std::begin(testArr5), std::end(testArr5), std::begin(testArr2), std::end(testArr2)) == std::begin(testArr5) + 11);
    REQUIRE(STL::find_end(std::begin(testArr1), std::end(testArr1), std::begin(testArr4), std::end(testArr4), 
       [](const auto &val1, const auto &val2) { return val1 == val2; }) == std::begin(testArr1));
+
+   // Forward, bidirectional and random access haystacks, the latter through
+   // the Horspool search for long byte patterns.
+   std::mt19937 gen(22);
+   for (auto alphabet : { 2, 3, 26 }) {
+      for (auto trial = 0; trial < 200; ++trial) {
+         std::string hay(gen() % 150, 'a');
+         for (auto &c : hay) {
+            c = static_cast<char>('a' + gen() % alphabet);
+         }
+         std::string needle(1 + gen() % 10, 'a');
+         for (auto &c : needle) {
+            c = static_cast<char>('a' + gen() % alphabet);
+         }
+         if (trial % 2 == 0 && needle.size() <= hay.size()) {
+            needle = hay.substr(gen() % (hay.size() - needle.size() + 1), needle.size());
+         }
+         auto expected = std::find_end(std::begin(hay), std::end(hay), std::begin(needle), std::end(needle)) - std::begin(hay);
+         REQUIRE(STL::find_end(std::begin(hay), std::end(hay), std::begin(needle), std::end(needle)) - std::begin(hay) == expected);
+
+         std::list<char> lhay(std::begin(hay), std::end(hay));
+         REQUIRE(std::distance(std::begin(lhay), STL::find_end(std::begin(lhay), std::end(lhay), std::begin(needle), std::end(needle))) == expected);
+         std::forward_list<char> fhay(std::begin(hay), std::end(hay));
+         REQUIRE(std::distance(std::begin(fhay), STL::find_end(std::begin(fhay), std::end(fhay), std::begin(needle), std::end(needle))) == expected);
+      }
+   }
 }
 
 TEST_CASE("find_first_of", "[find_first_of]")
@@ -316,6 +490,64 @@ TEST_CASE("find_first_of", "[find_first_of]")
 }
 
 
+
+TEST_CASE("searchers", "[searchers]")
+{
+   std::string text = "log: id=17 <<MARK>> payload <<MARK>>";
+   std::string marker = "<<MARK>>";
+   STL::boyer_moore_searcher bm(std::begin(marker), std::end(marker));
+   STL::boyer_moore_horspool_searcher bmh(std::begin(marker), std::end(marker));
+   STL::two_way_searcher tw(std::begin(marker), std::end(marker));
+   STL::default_searcher ds(std::begin(marker), std::end(marker));
+   REQUIRE(STL::search(std::begin(text), std::end(text), bm) == std::begin(text) + 11);
+   REQUIRE(STL::search(std::begin(text), std::end(text), bmh) == std::begin(text) + 11);
+   REQUIRE(STL::search(std::begin(text), std::end(text), tw) == std::begin(text) + 11);
+   REQUIRE(STL::search(std::begin(text), std::end(text), ds) == std::begin(text) + 11);
+   auto match = bm(std::begin(text) + 12, std::end(text));
+   REQUIRE(match.first == std::end(text) - 8);
+   REQUIRE(match.second == std::end(text));
+
+   std::string empty;
+   STL::boyer_moore_searcher bm_empty(std::begin(empty), std::end(empty));
+   REQUIRE(STL::search(std::begin(text), std::end(text), bm_empty) == std::begin(text));
+   REQUIRE(STL::search(std::begin(empty), std::end(empty), bm) == std::end(empty));
+
+   // Every searcher agrees with std::search; small alphabets give periodic
+   // patterns and many partial matches.
+   std::mt19937 gen(21);
+   for (auto alphabet : { 1, 2, 3, 26 }) {
+      for (auto trial = 0; trial < 300; ++trial) {
+         std::string hay(gen() % 200, 'a');
+         for (auto &c : hay) {
+            c = static_cast<char>('a' + gen() % alphabet);
+         }
+         std::string needle(gen() % 12, 'a');
+         for (auto &c : needle) {
+            c = static_cast<char>('a' + gen() % alphabet);
+         }
+         if (!hay.empty() && trial % 2 == 0 && needle.size() <= hay.size()) {
+            needle = hay.substr(gen() % (hay.size() - needle.size() + 1), needle.size());
+         }
+         auto expected = std::search(std::begin(hay), std::end(hay), std::begin(needle), std::end(needle));
+         REQUIRE(STL::search(std::begin(hay), std::end(hay), STL::boyer_moore_searcher(std::begin(needle), std::end(needle))) == expected);
+         REQUIRE(STL::search(std::begin(hay), std::end(hay), STL::boyer_moore_horspool_searcher(std::begin(needle), std::end(needle))) == expected);
+         REQUIRE(STL::search(std::begin(hay), std::end(hay), STL::two_way_searcher(std::begin(needle), std::end(needle))) == expected);
+
+         std::vector<int> ihay(std::begin(hay), std::end(hay)), ineedle(std::begin(needle), std::end(needle));
+         auto iexpected = std::begin(ihay) + (expected - std::begin(hay));
+         REQUIRE(STL::search(std::begin(ihay), std::end(ihay), STL::boyer_moore_searcher(std::begin(ineedle), std::end(ineedle))) == iexpected);
+         REQUIRE(STL::search(std::begin(ihay), std::end(ihay), STL::boyer_moore_horspool_searcher(std::begin(ineedle), std::end(ineedle))) == iexpected);
+      }
+   }
+
+   // A case-insensitive search through a matching hash and predicate.
+   auto fold = [](char c) { return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c); };
+   auto hash = [fold](char c) { return std::hash<char>()(fold(c)); };
+   auto same = [fold](char a, char b) { return fold(a) == fold(b); };
+   std::string upper = "PAYLOAD";
+   STL::boyer_moore_searcher folded(std::begin(upper), std::end(upper), hash, same);
+   REQUIRE(STL::search(std::begin(text), std::end(text), folded) == std::begin(text) + 20);
+}
 TEST_CASE("adjacent_find", "[adjacent_find]")
 {
    int testArr1[] = { 2, 1, 2, 3, 4, 5, 6, 1, 2, 3, 10, 1, 2, 3, 11, 12 };
@@ -482,6 +714,32 @@ TEST_CASE("move_backwards", "[move_backwards]")
    REQUIRE(testArr1[5] == nullptr);
 }
 
+TEST_CASE("memmove_fast_paths", "[memmove_fast_paths]")
+{
+   // Trivially copyable elements in contiguous ranges are copied with
+   // memmove, which keeps overlapping backward copies correct.
+   std::vector<int> overlap{ 1, 2, 3, 4, 5, 6, 7, 8 };
+   REQUIRE(STL::copy_backwards(std::begin(overlap), std::begin(overlap) + 6, std::end(overlap)) == std::begin(overlap) + 2);
+   REQUIRE(overlap == std::vector<int>({ 1, 2, 1, 2, 3, 4, 5, 6 }));
+   REQUIRE(STL::move(std::begin(overlap) + 2, std::end(overlap), std::begin(overlap)) == std::begin(overlap) + 6);
+   REQUIRE(overlap == std::vector<int>({ 1, 2, 3, 4, 5, 6, 5, 6 }));
+   REQUIRE(STL::move_backwards(std::begin(overlap), std::begin(overlap), std::end(overlap)) == std::end(overlap));
+   REQUIRE(STL::copy_n(std::begin(overlap), 0, std::begin(overlap) + 1) == std::begin(overlap) + 1);
+
+   struct point { int x; double y; };
+   std::vector<point> points{ { 1, 1.5 }, { 2, 2.5 }, { 3, 3.5 } };
+   std::vector<point> points_copy(3);
+   REQUIRE(STL::copy(points.cbegin(), points.cend(), std::begin(points_copy)) == std::end(points_copy));
+   REQUIRE(points_copy[2].x == 3);
+   REQUIRE(points_copy[2].y == 3.5);
+
+   // Elements with an assignment operator of their own are assigned one by one.
+   std::vector<std::string> words{ "a", "bb", "ccc" };
+   std::vector<std::string> moved(3);
+   REQUIRE(STL::move_backwards(std::begin(words), std::end(words), std::end(moved)) == std::begin(moved));
+   REQUIRE(moved == std::vector<std::string>({ "a", "bb", "ccc" }));
+}
+
 TEST_CASE("transform", "[transform]")
 {
    int testArr1[] = { 1, 2, 3, 4, 5, 6 };
@@ -722,21 +980,56 @@ TEST_CASE("unique", "[unique]")
    REQUIRE(e1 == t1);
 
    std::vector<int> t2 = { 1, 1, 2, 3, 4, 5 };
-   std::vector<int> e2 = { 1, 2, 3, 4, 5, 1 };
+   std::vector<int> e2 = { 1, 2, 3, 4, 5 };
 
    auto res = STL::unique(t2.begin(), t2.end(), p);
    REQUIRE(res == t2.begin() + 5);
-   REQUIRE(e2 == t2);
+   REQUIRE(e2 == std::vector<int>(t2.begin(), res));
 
    std::vector<int> t3 = { 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
-   std::vector<int> e3 = { 1, 2, 3, 4, 5, 5, 4, 3, 2, 1 };
+   std::vector<int> e3 = { 1, 2, 3, 4, 5 };
 
    res = STL::unique(t3.begin(), t3.end(), p);
    REQUIRE(res == t3.begin() + 5);
-   REQUIRE(e3 == t3);
+   REQUIRE(e3 == std::vector<int>(t3.begin(), res));
 
    std::vector<std::string> t4 = { "1", "2", "3", "4", "5" };
    REQUIRE(t4.end() == STL::unique(t4.begin(), t4.end(), p));
+
+   std::vector<int> t5;
+   REQUIRE(t5.end() == STL::unique(t5.begin(), t5.end()));
+
+   std::vector<int> t6 = { 7, 7, 7, 7, 7, 7, 7, 7 };
+   res = STL::unique(t6.begin(), t6.end());
+   REQUIRE(res == t6.begin() + 1);
+   REQUIRE(t6[0] == 7);
+
+   std::vector<std::unique_ptr<int>> t7;
+   for (auto i : { 1, 1, 2, 2, 2, 3 })
+      t7.emplace_back(std::make_unique<int>(i));
+   auto res7 = STL::unique(t7.begin(), t7.end(), [](const auto &a, const auto &b) { return *a == *b; });
+   REQUIRE(res7 == t7.begin() + 3);
+   REQUIRE(*t7[0] == 1);
+   REQUIRE(*t7[1] == 2);
+   REQUIRE(*t7[2] == 3);
+
+   std::vector<int> ids(100000);
+   for (auto i = 0; i < 100000; ++i)
+      ids[i] = i / 1000;
+   auto ids_end = STL::unique(ids.begin(), ids.end());
+   REQUIRE(ids_end == ids.begin() + 100);
+   REQUIRE(std::is_sorted(ids.begin(), ids_end));
+
+   std::vector<int> t8 = { 1, 1, 2, 3, 3, 3, 4, 1, 1 };
+   std::vector<int> e8 = { 1, 2, 3, 4, 1 };
+   std::vector<int> d8;
+   STL::unique_copy(t8.begin(), t8.end(), std::back_inserter(d8));
+   REQUIRE(d8 == e8);
+
+   std::istringstream stream("5 5 6 6 6 7 5");
+   std::vector<int> d9;
+   STL::unique_copy(std::istream_iterator<int>(stream), std::istream_iterator<int>(), std::back_inserter(d9));
+   REQUIRE(d9 == std::vector<int>({ 5, 6, 7, 5 }));
 }
 
 #include <chrono>
@@ -820,6 +1113,25 @@ TEST_CASE("partition", "[partition]")
    REQUIRE(STL::is_partitioned(std::begin(t8), std::end(t8), p));
    REQUIRE(STL::is_partitioned(std::begin(t9), std::end(t9), p));
    REQUIRE(STL::is_partitioned(std::begin(t10), std::end(t10), p));
+
+   auto p_tenant = [](const std::pair<int, int> &rec) { return rec.first % 3 == 0; };
+   std::vector<std::pair<int, int>> t11(50000);
+   for (auto i = 0; i < 50000; ++i)
+      t11[i] = { gen(), i };
+
+   auto e11 = t11;
+   auto res5 = std::stable_partition(e11.begin(), e11.end(), p_tenant);
+
+   auto t12 = t11;
+   REQUIRE(STL::stable_partition(t12.begin(), t12.end(), p_tenant) - t12.begin() == res5 - e11.begin());
+   REQUIRE(t12 == e11);
+
+   std::vector<std::pair<int, int>> small_buffer(100);
+   auto t13 = t11;
+   auto res6 = STL::stable_partition_adaptive(t13.begin(), t13.end(), small_buffer.data(),
+      std::ptrdiff_t{ 100 }, p_tenant);
+   REQUIRE(res6 - t13.begin() == res5 - e11.begin());
+   REQUIRE(t13 == e11);
 }
 
 TEST_CASE("heap", "[heap]")
@@ -879,6 +1191,52 @@ TEST_CASE("sort", "[sort]")
    STL::sort(v.begin(), v.end());
    REQUIRE(is_sorted(v.begin(), v.end()));
 
+   auto reversed = v;
+   STL::sort(reversed.begin(), reversed.end(), std::greater<int>());
+   REQUIRE(reversed == std::vector<int>({ 24, 19, 18, 17, 10, 6, 5, 3, 1 }));
+
+   std::mt19937 sort_engine(42);
+   for (auto size : { 0, 1, 2, 3, 15, 16, 17, 100, 129, 1000, 100000 })
+   {
+      std::uniform_int_distribution<int> sort_dist(0, size / 4);
+      std::vector<int> random(size);
+      std::generate(random.begin(), random.end(), [&]() { return sort_dist(sort_engine); });
+
+      std::vector<int> ascending(random);
+      std::sort(ascending.begin(), ascending.end());
+      std::vector<int> descending(ascending.rbegin(), ascending.rend());
+      std::vector<int> organ_pipe(ascending.begin(), ascending.begin() + size / 2);
+      organ_pipe.insert(organ_pipe.end(), descending.begin(), descending.begin() + (size - size / 2));
+
+      std::vector<int> sawtooth(size);
+      for (auto i = 0; i < size; ++i)
+         sawtooth[i] = i % 37;
+      std::vector<int> all_equal(size, 7);
+
+      for (auto input : { random, ascending, descending, organ_pipe, sawtooth, all_equal })
+      {
+         auto expected = input;
+         std::sort(expected.begin(), expected.end());
+         STL::sort(input.begin(), input.end());
+         REQUIRE(input == expected);
+      }
+   }
+
+   std::uniform_real_distribution<double> real_dist(-1000.0, 1000.0);
+   std::vector<double> reals(50000);
+   std::generate(reals.begin(), reals.end(), [&]() { return real_dist(sort_engine); });
+   auto expected_reals = reals;
+   std::sort(expected_reals.begin(), expected_reals.end(), std::greater<double>());
+   STL::sort(reals.begin(), reals.end(), std::greater<double>());
+   REQUIRE(reals == expected_reals);
+
+   std::vector<std::string> words = { "pear", "apple", "fig", "kiwi", "banana", "cherry", "date", "grape",
+      "lemon", "lime", "mango", "melon", "nectarine", "orange", "papaya", "peach", "plum", "quince" };
+   auto expected_words = words;
+   std::sort(expected_words.begin(), expected_words.end());
+   STL::sort(words.begin(), words.end());
+   REQUIRE(words == expected_words);
+
    REQUIRE(STL::lower_bound(std::begin(v), std::end(v), 7, std::less<int>()) == v.begin() + 4);
    REQUIRE(STL::lower_bound(std::begin(v), std::end(v), 8, std::less<int>()) == v.begin() + 4);
    REQUIRE(STL::lower_bound(std::begin(v), std::end(v), 6, std::less<int>()) == v.begin() + 3);
@@ -944,6 +1302,273 @@ TEST_CASE("sort", "[sort]")
    REQUIRE(STL::upper_bound(std::begin(v4), std::end(v4), 6) == v4.end());
 }
 
+TEST_CASE("nth_element", "[nth_element]")
+{
+   std::vector<int> v0;
+   STL::nth_element(v0.begin(), v0.begin(), v0.end());
+
+   std::vector<int> v1 = { 5, 6, 4, 3, 2, 6, 7, 9, 3 };
+   STL::nth_element(v1.begin(), v1.begin() + 4, v1.end());
+   REQUIRE(v1[4] == 5);
+
+   std::mt19937 engine(13);
+   for (auto size : { 1, 2, 17, 100, 1000, 100000 })
+   {
+      std::uniform_int_distribution<int> dist(0, size / 3);
+      std::vector<int> random(size);
+      std::generate(random.begin(), random.end(), [&]() { return dist(engine); });
+      std::vector<int> all_equal(size, 3);
+      std::vector<int> ascending(size);
+      std::iota(ascending.begin(), ascending.end(), 0);
+
+      for (auto input : { random, all_equal, ascending })
+      {
+         auto sorted = input;
+         std::sort(sorted.begin(), sorted.end());
+
+         for (auto n : { 0, size / 2, size - 1 })
+         {
+            auto selected = input;
+            auto nth = selected.begin() + n;
+            STL::nth_element(selected.begin(), nth, selected.end());
+            REQUIRE(*nth == sorted[n]);
+            REQUIRE(std::all_of(selected.begin(), nth, [&](int val) { return val <= *nth; }));
+            REQUIRE(std::all_of(nth, selected.end(), [&](int val) { return val >= *nth; }));
+
+            auto deterministic = input;
+            nth = deterministic.begin() + n;
+            STL::median_of_medians_select(deterministic.begin(), nth, deterministic.end(), std::less<int>());
+            REQUIRE(*nth == sorted[n]);
+            REQUIRE(std::all_of(deterministic.begin(), nth, [&](int val) { return val <= *nth; }));
+            REQUIRE(std::all_of(nth, deterministic.end(), [&](int val) { return val >= *nth; }));
+         }
+      }
+   }
+}
+
+TEST_CASE("partial_sort", "[partial_sort]")
+{
+   std::vector<int> v1 = { 5, 7, 4, 2, 8, 6, 1, 9, 0, 3 };
+   STL::partial_sort(v1.begin(), v1.begin() + 3, v1.end());
+   REQUIRE(std::vector<int>(v1.begin(), v1.begin() + 3) == std::vector<int>({ 0, 1, 2 }));
+
+   std::mt19937 engine(17);
+   std::uniform_int_distribution<int> dist(0, 5000);
+   std::vector<int> samples(20000);
+   std::generate(samples.begin(), samples.end(), [&]() { return dist(engine); });
+   auto sorted = samples;
+   std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+
+   for (auto k : { 0, 1, 10, 2499, 2500, 15000, 20000 })
+   {
+      auto top = samples;
+      STL::partial_sort(top.begin(), top.begin() + k, top.end(), std::greater<int>());
+      REQUIRE(std::equal(top.begin(), top.begin() + k, sorted.begin()));
+
+      std::vector<int> copy(k);
+      auto res = STL::partial_sort_copy(samples.begin(), samples.end(), copy.begin(), copy.end(), std::greater<int>());
+      REQUIRE(res == copy.end());
+      REQUIRE(std::equal(copy.begin(), copy.end(), sorted.begin()));
+   }
+
+   std::vector<int> large(5);
+   auto res = STL::partial_sort_copy(v1.begin(), v1.begin() + 3, large.begin(), large.end());
+   REQUIRE(res == large.begin() + 3);
+   REQUIRE(std::vector<int>(large.begin(), res) == std::vector<int>({ 0, 1, 2 }));
+}
+
+TEST_CASE("stable_sort", "[stable_sort]")
+{
+   std::vector<int> v0;
+   STL::stable_sort(v0.begin(), v0.end());
+   REQUIRE(v0.empty());
+
+   std::vector<int> v1 = { 5, 3, 9, 1, 1, 7 };
+   STL::stable_sort(v1.begin(), v1.end());
+   REQUIRE(v1 == std::vector<int>({ 1, 1, 3, 5, 7, 9 }));
+
+   using record = std::pair<int, int>;
+   auto by_key = [](const record &a, const record &b) { return a.first < b.first; };
+
+   std::mt19937 engine(7);
+   for (auto size : { 2, 31, 32, 33, 100, 1000, 54321 })
+   {
+      std::uniform_int_distribution<int> key_dist(0, size / 8);
+      std::vector<record> records(size);
+      for (auto i = 0; i < size; ++i)
+         records[i] = { key_dist(engine), i };
+
+      auto expected = records;
+      std::stable_sort(expected.begin(), expected.end(), by_key);
+
+      auto buffered = records;
+      STL::stable_sort(buffered.begin(), buffered.end(), by_key);
+      REQUIRE(buffered == expected);
+
+      auto in_place = records;
+      STL::inplace_stable_sort(in_place.begin(), in_place.end(), by_key);
+      REQUIRE(in_place == expected);
+   }
+
+   std::vector<std::unique_ptr<int>> owners;
+   for (auto i : { 4, 2, 8, 6 })
+      owners.emplace_back(std::make_unique<int>(i));
+   STL::stable_sort(owners.begin(), owners.end(), [](const auto &a, const auto &b) { return *a < *b; });
+   REQUIRE(*owners[0] == 2);
+   REQUIRE(*owners[3] == 8);
+}
+
+TEST_CASE("timsort", "[timsort]")
+{
+   std::vector<int> v0;
+   STL::timsort(v0.begin(), v0.end());
+   REQUIRE(v0.empty());
+
+   std::vector<int> v1 = { 9, 8, 7, 1, 2, 3, 6, 5, 4 };
+   STL::timsort(v1.begin(), v1.end());
+   REQUIRE(v1 == std::vector<int>({ 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+
+   using record = std::pair<int, int>;
+   auto by_key = [](const record &a, const record &b) { return a.first < b.first; };
+
+   std::mt19937 engine(9);
+   for (auto size : { 2, 63, 64, 65, 1000, 100000 })
+   {
+      std::uniform_int_distribution<int> key_dist(0, size);
+      std::uniform_int_distribution<int> pos_dist(0, size - 1);
+
+      std::vector<record> random(size);
+      for (auto i = 0; i < size; ++i)
+         random[i] = { key_dist(engine) / 4, i };
+
+      std::vector<record> appended(size);
+      for (auto i = 0; i < size; ++i)
+         appended[i] = { i / 3, i };
+      for (auto late = size / 100; late >= 0; --late)
+         appended[pos_dist(engine)].first = key_dist(engine);
+
+      std::vector<record> descending(size);
+      for (auto i = 0; i < size; ++i)
+         descending[i] = { (size - i) / 2, i };
+
+      std::vector<record> sawtooth(size);
+      for (auto i = 0; i < size; ++i)
+         sawtooth[i] = { i % 1000 < 500 ? i % 500 : 1000 - i % 1000, i };
+
+      for (auto input : { random, appended, descending, sawtooth })
+      {
+         auto expected = input;
+         std::stable_sort(expected.begin(), expected.end(), by_key);
+         STL::timsort(input.begin(), input.end(), by_key);
+         REQUIRE(input == expected);
+      }
+   }
+
+   std::vector<int> sorted(1000);
+   std::iota(sorted.begin(), sorted.end(), 0);
+   auto comparisons = 0;
+   STL::timsort(sorted.begin(), sorted.end(), [&comparisons](int a, int b) { ++comparisons; return a < b; });
+   REQUIRE(comparisons == 999);
+}
+
+TEST_CASE("radix_sort", "[radix_sort]")
+{
+   std::vector<int> v0;
+   STL::radix_sort(v0.begin(), v0.end());
+   REQUIRE(v0.empty());
+
+   std::vector<int> v1 = { 3, -1, 7, -200, 0, 5 };
+   STL::radix_sort(v1.begin(), v1.end());
+   REQUIRE(v1 == std::vector<int>({ -200, -1, 0, 3, 5, 7 }));
+
+   std::mt19937_64 engine(3);
+
+   std::vector<int> ints(100000);
+   std::uniform_int_distribution<int> int_dist(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+   std::generate(ints.begin(), ints.end(), [&]() { return int_dist(engine); });
+   auto expected_ints = ints;
+   std::sort(expected_ints.begin(), expected_ints.end());
+   STL::radix_sort(ints.begin(), ints.end());
+   REQUIRE(ints == expected_ints);
+
+   std::vector<uint64_t> stamps(100000);
+   std::uniform_int_distribution<uint64_t> stamp_dist(1500000000000ull, 1600000000000ull);
+   std::generate(stamps.begin(), stamps.end(), [&]() { return stamp_dist(engine); });
+   auto expected_stamps = stamps;
+   std::sort(expected_stamps.begin(), expected_stamps.end());
+   STL::radix_sort(stamps.begin(), stamps.end());
+   REQUIRE(stamps == expected_stamps);
+
+   std::vector<float> floats(10000);
+   std::uniform_real_distribution<float> float_dist(-1e6f, 1e6f);
+   std::generate(floats.begin(), floats.end(), [&]() { return float_dist(engine); });
+   floats[0] = -std::numeric_limits<float>::infinity();
+   floats[1] = std::numeric_limits<float>::infinity();
+   auto expected_floats = floats;
+   std::sort(expected_floats.begin(), expected_floats.end());
+   STL::radix_sort(floats.begin(), floats.end());
+   REQUIRE(floats == expected_floats);
+
+   std::vector<double> doubles(10000);
+   std::uniform_real_distribution<double> double_dist(-1e-3, 1e9);
+   std::generate(doubles.begin(), doubles.end(), [&]() { return double_dist(engine); });
+   auto expected_doubles = doubles;
+   std::sort(expected_doubles.begin(), expected_doubles.end());
+   STL::radix_sort(doubles.begin(), doubles.end());
+   REQUIRE(doubles == expected_doubles);
+
+   using record = std::pair<int64_t, int>;
+   std::vector<record> records(20000);
+   std::uniform_int_distribution<int64_t> key_dist(-50, 50);
+   for (auto i = 0; i < 20000; ++i)
+      records[i] = { key_dist(engine), i };
+   auto expected_records = records;
+   std::stable_sort(expected_records.begin(), expected_records.end(),
+      [](const record &a, const record &b) { return a.first < b.first; });
+   STL::radix_sort_by_key(records.begin(), records.end(), [](const record &rec) { return rec.first; });
+   REQUIRE(records == expected_records);
+
+   // -0.0 and +0.0 compare equal and keep their order.
+   using signed_zero = std::pair<double, int>;
+   std::vector<signed_zero> zeros(200);
+   for (auto i = 0; i < 200; ++i)
+      zeros[i] = { i % 3 == 0 ? -0.0 : i % 3 == 1 ? 0.0 : -1.0, i };
+   auto expected_zeros = zeros;
+   std::stable_sort(expected_zeros.begin(), expected_zeros.end(),
+      [](const signed_zero &a, const signed_zero &b) { return a.first < b.first; });
+   STL::radix_sort_by_key(zeros.begin(), zeros.end(), [](const signed_zero &z) { return z.first; });
+   REQUIRE(zeros == expected_zeros);
+}
+
+TEST_CASE("string_sort", "[string_sort]")
+{
+   std::vector<std::string> v0;
+   STL::string_sort(v0.begin(), v0.end());
+   REQUIRE(v0.empty());
+
+   std::vector<std::string> v1 = { "b", "", "abc", "ab", "a", "abd", "", "\xff", "B" };
+   STL::string_sort(v1.begin(), v1.end());
+   REQUIRE(v1 == std::vector<std::string>({ "", "", "B", "a", "ab", "abc", "abd", "b", "\xff" }));
+
+   std::mt19937 engine(5);
+   std::uniform_int_distribution<int> length_dist(0, 12);
+   std::uniform_int_distribution<int> char_dist(0, 255);
+   const std::string prefixes[] = { "https://example.com/", "https://example.org/api/", "2024-01-01 INFO ", "" };
+
+   std::vector<std::string> lines(30000);
+   for (auto i = 0u; i < lines.size(); ++i)
+   {
+      lines[i] = prefixes[i % 4];
+      for (auto len = length_dist(engine); len > 0; --len)
+         lines[i] += static_cast<char>(i % 3 == 0 ? 'a' + char_dist(engine) % 3 : char_dist(engine));
+   }
+
+   auto expected = lines;
+   std::sort(expected.begin(), expected.end());
+   STL::string_sort(lines.begin(), lines.end());
+   REQUIRE(lines == expected);
+}
+
 TEST_CASE("merge", "[merge]")
 {
    std::vector<int> v00;
@@ -979,6 +1604,38 @@ TEST_CASE("merge", "[merge]")
    STL::inplace_merge(std::begin(v60), std::begin(v60) + 4, std::end(v60));
    REQUIRE(v60 == std::vector<int>({ 1, 2, 3, 4, 7, 8, 9, 10 }));
 
+   using record = std::pair<int, int>;
+   auto by_key = [](const record &a, const record &b) { return a.first < b.first; };
+
+   std::mt19937 engine(11);
+   for (auto split : { 1, 10, 5000, 9990, 9999 })
+   {
+      std::uniform_int_distribution<int> key_dist(0, 500);
+      std::vector<record> runs(10000);
+      for (auto i = 0; i < 10000; ++i)
+         runs[i] = { key_dist(engine), i };
+      std::sort(runs.begin(), runs.begin() + split, by_key);
+      std::sort(runs.begin() + split, runs.end(), by_key);
+
+      auto expected = runs;
+      std::inplace_merge(expected.begin(), expected.begin() + split, expected.end(), by_key);
+
+      auto buffered = runs;
+      STL::inplace_merge(buffered.begin(), buffered.begin() + split, buffered.end(), by_key);
+      REQUIRE(buffered == expected);
+
+      std::vector<record> small_buffer(64);
+      auto adaptive = runs;
+      STL::merge_adaptive(adaptive.begin(), adaptive.begin() + split, adaptive.end(),
+         std::ptrdiff_t{ split }, std::ptrdiff_t{ 10000 - split }, small_buffer.data(), std::ptrdiff_t{ 64 }, by_key);
+      REQUIRE(adaptive == expected);
+
+      auto unbuffered = runs;
+      STL::merge_without_buffer(unbuffered.begin(), unbuffered.begin() + split, unbuffered.end(),
+         std::ptrdiff_t{ split }, std::ptrdiff_t{ 10000 - split }, by_key);
+      REQUIRE(unbuffered == expected);
+   }
+
    std::vector<int> v70 = { 1, 2, 3, 4, 5, 6, 7, 8 };
    std::vector<int> v71;
    std::vector<int> v72 = { 9, 10 };
@@ -1028,6 +1685,351 @@ TEST_CASE("merge", "[merge]")
    REQUIRE(it == std::end(v103));
 }
 
+TEST_CASE("merge_k", "[merge_k]")
+{
+   using runs_t = std::vector<std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator>>;
+   std::vector<int> out;
+   STL::merge_k(runs_t(), std::back_inserter(out));
+   REQUIRE(out.empty());
+
+   std::mt19937 gen(19);
+   for (auto k : { 1, 2, 3, 5, 16, 17, 256 }) {
+      // Keys with a run id so that the order of equivalent elements is checked.
+      std::vector<std::vector<std::pair<int, int>>> runs(k);
+      std::vector<std::pair<int, int>> expected;
+      for (auto r = 0; r < k; ++r) {
+         runs[r].resize(r % 4 == 3 ? 0 : gen() % 200);
+         for (auto &e : runs[r]) {
+            e = { static_cast<int>(gen() % 50), r };
+         }
+         std::stable_sort(std::begin(runs[r]), std::end(runs[r]));
+         expected.insert(std::end(expected), std::begin(runs[r]), std::end(runs[r]));
+      }
+      auto by_key = [](const std::pair<int, int> &a, const std::pair<int, int> &b) { return a.first < b.first; };
+      std::stable_sort(std::begin(expected), std::end(expected), by_key);
+
+      std::vector<std::pair<std::vector<std::pair<int, int>>::iterator, std::vector<std::pair<int, int>>::iterator>> ranges;
+      for (auto &run : runs) {
+         ranges.emplace_back(std::begin(run), std::end(run));
+      }
+      std::vector<std::pair<int, int>> merged(expected.size());
+      REQUIRE(STL::merge_k(ranges, std::begin(merged), by_key) == std::end(merged));
+      REQUIRE(merged == expected);
+   }
+
+   std::list<int> l0 = { 1, 4, 9 }, l1 = { 2, 3, 10 }, l2 = { 0, 4, 5 };
+   std::vector<std::pair<std::list<int>::iterator, std::list<int>::iterator>> lists = {
+      { std::begin(l0), std::end(l0) }, { std::begin(l1), std::end(l1) }, { std::begin(l2), std::end(l2) } };
+   STL::merge_k(lists, std::back_inserter(out));
+   REQUIRE(out == std::vector<int>({ 0, 1, 2, 3, 4, 4, 5, 9, 10 }));
+}
+
+TEST_CASE("external_sort", "[external_sort]")
+{
+   auto dir = std::filesystem::temp_directory_path() / "stl_external_sort_test";
+   std::filesystem::create_directories(dir);
+
+   STL::external_sort_options options;
+   options.memory_budget = 1024;
+   options.min_block_size = 64;
+   options.temp_directory = dir;
+
+   std::vector<int> out;
+   std::vector<int> in;
+   STL::external_sort(std::begin(in), std::end(in), std::back_inserter(out), options);
+   REQUIRE(out.empty());
+
+   // Fits in one run, so nothing is spilled.
+   in = { 5, 3, 9, 1 };
+   STL::external_sort(std::begin(in), std::end(in), std::back_inserter(out), options);
+   REQUIRE(out == std::vector<int>({ 1, 3, 5, 9 }));
+
+   // 256 ints per run and 7 double buffered runs per merge pass: 40 runs
+   // take two passes.
+   std::mt19937 gen(20);
+   in.resize(10000);
+   for (auto &e : in) {
+      e = static_cast<int>(gen() % 5000);
+   }
+   for (auto size : { 257, 256 * 7, 256 * 7 + 1, 10000 }) {
+      std::vector<int> sorted(std::begin(in), std::begin(in) + size);
+      std::sort(std::begin(sorted), std::end(sorted));
+      out.assign(size, -1);
+      REQUIRE(STL::external_sort(std::begin(in), std::begin(in) + size, std::begin(out), options) == std::end(out));
+      REQUIRE(out == sorted);
+   }
+
+   std::istringstream text("4 8 1 7 3 3 0 9");
+   out.clear();
+   options.memory_budget = 2 * sizeof(int);
+   STL::external_sort(std::istream_iterator<int>(text), std::istream_iterator<int>(), std::back_inserter(out),
+                      std::greater<>(), options);
+   REQUIRE(out == std::vector<int>({ 9, 8, 7, 4, 3, 3, 1, 0 }));
+
+   struct record
+   {
+      std::uint64_t key;
+      std::uint32_t payload;
+   };
+   std::vector<record> records(5000);
+   for (auto i = 0u; i < records.size(); ++i) {
+      records[i] = { gen() % 1000, i };
+   }
+   // Temporary files are created on construction under distinct names.
+   {
+      STL::temporary_file t1(dir), t2(dir);
+      REQUIRE(t1.path() != t2.path());
+      REQUIRE(std::filesystem::exists(t1.path()));
+      REQUIRE(std::filesystem::exists(t2.path()));
+   }
+   REQUIRE(std::filesystem::is_empty(dir));
+
+   // Block I/O runs on one thread in submission order; errors reach the
+   // future of the job.
+   {
+      STL::io_thread io;
+      std::vector<int> order;
+      auto first_job = io.submit([&order] { order.push_back(1); return 1; });
+      auto failing_job = io.submit([&order]() -> int { order.push_back(2); throw std::runtime_error("disk full"); });
+      REQUIRE(first_job.get() == 1);
+      REQUIRE_THROWS(failing_job.get());
+      REQUIRE(order == std::vector<int>({ 1, 2 }));
+   }
+
+   auto path = dir / "records.bin";
+   {
+      std::ofstream file(path, std::ios::binary);
+      file.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(record));
+   }
+   options.memory_budget = 100 * sizeof(record);
+   auto by_key = [](const record &a, const record &b) { return a.key < b.key; };
+   STL::external_sort_file<record>(path, path, by_key, options);
+
+   std::vector<record> sorted(records.size() + 1);
+   {
+      std::ifstream file(path, std::ios::binary);
+      file.read(reinterpret_cast<char *>(sorted.data()), sorted.size() * sizeof(record));
+      REQUIRE(file.gcount() == static_cast<std::streamsize>(records.size() * sizeof(record)));
+   }
+   sorted.pop_back();
+   REQUIRE(std::is_sorted(std::begin(sorted), std::end(sorted), by_key));
+   std::vector<bool> seen(records.size());
+   for (auto &r : sorted) {
+      REQUIRE(r.key == records[r.payload].key);
+      seen[r.payload] = true;
+   }
+   REQUIRE(std::count(std::begin(seen), std::end(seen), false) == 0);
+
+   // Only the sorted file is left behind.
+   std::filesystem::remove(path);
+   REQUIRE(std::filesystem::is_empty(dir));
+   std::filesystem::remove(dir);
+}
+
+TEST_CASE("merge_path", "[merge_path]")
+{
+   std::mt19937 gen(11);
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 6;
+   // Few distinct keys so that runs of equal elements cross segment boundaries.
+   for (auto range : { 50, 1 << 30 }) {
+      std::vector<std::pair<int, int>> a(n), b(n / 3 + 5);
+      for (auto i = 0u; i < a.size(); ++i) {
+         a[i] = { static_cast<int>(gen() % range), 1 };
+      }
+      for (auto i = 0u; i < b.size(); ++i) {
+         b[i] = { static_cast<int>(gen() % range), 2 };
+      }
+      auto by_key = [](const std::pair<int, int> &x, const std::pair<int, int> &y) { return x.first < y.first; };
+      std::sort(std::begin(a), std::end(a), by_key);
+      std::sort(std::begin(b), std::end(b), by_key);
+
+      std::vector<std::pair<int, int>> seq(a.size() + b.size()), par(seq.size());
+      auto seq_end = STL::merge(std::begin(a), std::end(a), std::begin(b), std::end(b), std::begin(seq), by_key);
+      auto par_end = STL::merge(STL::execution::par, std::begin(a), std::end(a), std::begin(b), std::end(b), std::begin(par), by_key);
+      REQUIRE(par_end == std::end(par));
+      REQUIRE(seq_end == std::end(seq));
+      REQUIRE(par == seq);
+
+      using op_t = std::function<std::vector<std::pair<int, int>>::iterator(std::vector<std::pair<int, int>>::iterator)>;
+      std::vector<std::pair<op_t, op_t>> ops = {
+         { [&](auto d) { return STL::set_union(std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); },
+           [&](auto d) { return STL::set_union(STL::execution::par, std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); } },
+         { [&](auto d) { return STL::set_intersection(std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); },
+           [&](auto d) { return STL::set_intersection(STL::execution::par, std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); } },
+         { [&](auto d) { return STL::set_difference(std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); },
+           [&](auto d) { return STL::set_difference(STL::execution::par, std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); } },
+         { [&](auto d) { return STL::set_symmetric_difference(std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); },
+           [&](auto d) { return STL::set_symmetric_difference(STL::execution::par, std::begin(a), std::end(a), std::begin(b), std::end(b), d, by_key); } },
+      };
+      for (auto &op : ops) {
+         std::fill(std::begin(seq), std::end(seq), std::make_pair(-1, -1));
+         std::fill(std::begin(par), std::end(par), std::make_pair(-1, -1));
+         seq_end = op.first(std::begin(seq));
+         par_end = op.second(std::begin(par));
+         REQUIRE(par_end - std::begin(par) == seq_end - std::begin(seq));
+         REQUIRE(par == seq);
+      }
+   }
+
+   std::vector<int> x(n), y(n);
+   for (auto i = 0; i < n; ++i) {
+      x[i] = 2 * i;
+      y[i] = 3 * i;
+   }
+   std::vector<int> out(2 * n);
+   auto end = STL::set_intersection(STL::execution::par, std::begin(x), std::end(x), std::begin(y), std::end(y), std::begin(out));
+   REQUIRE(end - std::begin(out) == (n - 1) / 3 + 1);
+   REQUIRE(STL::all_of(std::begin(out), end, [](int i) { return i % 6 == 0; }));
+   REQUIRE(STL::merge(STL::execution::par_unseq, std::begin(x), std::end(x), std::begin(y), std::end(y), std::begin(out)) == std::end(out));
+   REQUIRE(std::is_sorted(std::begin(out), std::end(out)));
+}
+
+TEST_CASE("gallop", "[gallop]")
+{
+   std::mt19937 gen(5);
+   for (auto trial = 0; trial < 20; ++trial) {
+      std::vector<int> large(5000 + gen() % 5000), small(1 + gen() % 40);
+      const auto range = trial % 2 ? 100 : 100000;
+      for (auto &i : large) {
+         i = static_cast<int>(gen() % range);
+      }
+      for (auto &i : small) {
+         i = static_cast<int>(gen() % range);
+      }
+      std::sort(std::begin(large), std::end(large));
+      std::sort(std::begin(small), std::end(small));
+      // Lists take the linear path and serve as reference.
+      std::list<int> large_list(std::begin(large), std::end(large));
+      std::list<int> small_list(std::begin(small), std::end(small));
+
+      std::vector<int> expected(large.size()), result(large.size());
+      auto check = [&](auto op) {
+         std::fill(std::begin(expected), std::end(expected), -1);
+         std::fill(std::begin(result), std::end(result), -1);
+         auto expected_end = op(large_list, small_list, std::begin(expected));
+         auto result_end = op(large, small, std::begin(result));
+         REQUIRE(result_end - std::begin(result) == expected_end - std::begin(expected));
+         REQUIRE(result == expected);
+         expected_end = op(small_list, large_list, std::begin(expected));
+         result_end = op(small, large, std::begin(result));
+         REQUIRE(result_end - std::begin(result) == expected_end - std::begin(expected));
+         REQUIRE(result == expected);
+      };
+      check([](auto &a, auto &b, auto d) { return STL::set_intersection(std::begin(a), std::end(a), std::begin(b), std::end(b), d); });
+      check([](auto &a, auto &b, auto d) { return STL::set_difference(std::begin(a), std::end(a), std::begin(b), std::end(b), d); });
+
+      REQUIRE(STL::includes(std::begin(large), std::end(large), std::begin(small), std::end(small)) ==
+              std::includes(std::begin(large), std::end(large), std::begin(small), std::end(small)));
+      REQUIRE(STL::includes(std::begin(large_list), std::end(large_list), std::begin(small_list), std::end(small_list)) ==
+              std::includes(std::begin(large), std::end(large), std::begin(small), std::end(small)));
+      std::vector<int> subset;
+      for (auto i = 0u; i < large.size(); i += 1 + gen() % 500) {
+         subset.push_back(large[i]);
+      }
+      REQUIRE(STL::includes(std::begin(large), std::end(large), std::begin(subset), std::end(subset)));
+      subset.push_back(range);
+      REQUIRE(!STL::includes(std::begin(large), std::end(large), std::begin(subset), std::end(subset)));
+   }
+
+   std::vector<int> dup = { 1, 1, 2, 3 };
+   std::vector<int> ones(100, 1);
+   REQUIRE(STL::includes(std::begin(ones), std::end(ones), std::begin(dup), std::begin(dup) + 2));
+   REQUIRE(!STL::includes(std::begin(ones), std::end(ones), std::begin(dup), std::end(dup)));
+   std::vector<int> out(4);
+   REQUIRE(STL::set_intersection(std::begin(ones), std::end(ones), std::begin(dup), std::end(dup), std::begin(out)) == std::begin(out) + 2);
+}
+
+TEST_CASE("simd_set_intersection", "[simd_set_intersection]")
+{
+   REQUIRE(STL::is_contiguous_iterator<int *>());
+   REQUIRE(STL::is_contiguous_iterator<std::vector<int>::const_iterator>());
+   REQUIRE(STL::is_contiguous_iterator<std::string::iterator>());
+   REQUIRE(!STL::is_contiguous_iterator<std::vector<bool>::iterator>());
+   REQUIRE(!STL::is_contiguous_iterator<std::list<int>::iterator>());
+
+   std::mt19937 gen(3);
+   auto check = [&gen](auto zero, std::size_t na, std::size_t nb, std::size_t range, bool unique) {
+      using T = decltype(zero);
+      std::vector<T> a(na), b(nb);
+      for (auto &i : a) {
+         i = static_cast<T>(gen() % range);
+      }
+      for (auto &i : b) {
+         i = static_cast<T>(gen() % range);
+      }
+      std::sort(std::begin(a), std::end(a));
+      std::sort(std::begin(b), std::end(b));
+      if (unique) {
+         a.erase(std::unique(std::begin(a), std::end(a)), std::end(a));
+         b.erase(std::unique(std::begin(b), std::end(b)), std::end(b));
+      }
+
+      std::vector<T> expected;
+      std::set_intersection(std::begin(a), std::end(a), std::begin(b), std::end(b), std::back_inserter(expected));
+      std::vector<T> result;
+      STL::set_intersection(std::begin(a), std::end(a), std::begin(b), std::end(b), std::back_inserter(result));
+      REQUIRE(result == expected);
+      result.assign(a.size(), T{});
+      auto end = STL::set_intersection(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), result.data());
+      REQUIRE(std::vector<T>(result.data(), end) == expected);
+
+      // Every kernel this processor can run, whatever level is active.
+      for (auto level : { STL::simd::isa_level::sse42, STL::simd::isa_level::avx2 }) {
+         auto kernel = STL::simd::intersect_kernels<T>.resolve(level);
+         if (level > STL::simd::cpu_isa_level() || !kernel)
+            continue;
+         std::vector<T> out(a.size() + 8);
+         std::size_t ia = 0, ib = 0;
+         auto k = kernel(a.data(), a.size(), b.data(), b.size(), out.data(), &ia, &ib);
+         std::set_intersection(std::begin(a) + ia, std::end(a), std::begin(b) + ib, std::end(b), std::begin(out) + k);
+         out.resize(expected.size());
+         REQUIRE(out == expected);
+      }
+   };
+
+   for (auto n : { 0u, 1u, 5u, 9u, 17u, 100u, 1000u, 20000u }) {
+      for (auto unique : { true, false }) {
+         check(std::uint32_t{}, n, n / 2 + 3, 3 * n + 1, unique);
+         check(std::int32_t{}, n + 7, n, 2 * n + 1, unique);
+         check(std::uint64_t{}, n, n, 4 * n + 1, unique);
+         check(std::int64_t{}, n / 3, n, n + 1, unique);
+      }
+   }
+
+   std::vector<std::int32_t> negative = { -9, -7, -5, -3, -1, 0, 2, 4, 6, 8, 10, 12 };
+   std::vector<std::int32_t> mixed = { -8, -7, -6, -5, -4, -3, 1, 2, 3, 4, 5, 6, 7, 8 };
+   std::vector<std::int32_t> out;
+   STL::set_intersection(std::begin(negative), std::end(negative), std::begin(mixed), std::end(mixed), std::back_inserter(out));
+   REQUIRE(out == std::vector<std::int32_t>({ -7, -5, -3, 2, 4, 6, 8 }));
+
+   // Duplicates scattered through long ranges, so the kernels restart after
+   // each one.
+   std::vector<std::uint32_t> dup1, dup2;
+   for (auto i = 0u; i < 5000; ++i) {
+      dup1.push_back(3 * i);
+      dup2.push_back(2 * i);
+      if (i % 700 == 1)
+         dup1.push_back(3 * i);
+      if (i % 900 == 2)
+         dup2.push_back(2 * i);
+   }
+   std::vector<std::uint32_t> dup_expected, dup_result;
+   std::set_intersection(std::begin(dup1), std::end(dup1), std::begin(dup2), std::end(dup2), std::back_inserter(dup_expected));
+   STL::set_intersection(std::begin(dup1), std::end(dup1), std::begin(dup2), std::end(dup2), std::back_inserter(dup_result));
+   REQUIRE(dup_result == dup_expected);
+
+   // Sorted by a std::less of another type, which the kernels do not follow.
+   std::vector<std::uint32_t> as_signed1 = { 0xfffffff0u, 0xffffffffu, 1, 2, 3 };
+   std::vector<std::uint32_t> as_signed2 = { 0xfffffff0u, 0xfffffffeu, 0, 2, 3, 4 };
+   std::vector<std::uint32_t> expected, result;
+   std::set_intersection(std::begin(as_signed1), std::end(as_signed1), std::begin(as_signed2), std::end(as_signed2),
+      std::back_inserter(expected), std::less<int>());
+   STL::set_intersection(std::begin(as_signed1), std::end(as_signed1), std::begin(as_signed2), std::end(as_signed2),
+      std::back_inserter(result), std::less<int>());
+   REQUIRE(result == expected);
+   REQUIRE(result == std::vector<std::uint32_t>({ 0xfffffff0u, 2, 3 }));
+}
+
 TEST_CASE("accumulate", "[accumulate]")
 {
    std::vector<int> v0 = { 1, 2, 3, 4, 5, 6 };
@@ -1058,6 +2060,26 @@ TEST_CASE("reduce", "[reduce]")
 {
    std::vector<int> v1 = { 1, 2, 3, 4, 5, 6 };
    REQUIRE(STL::reduce(std::begin(v1), std::end(v1)) == 21);
+   REQUIRE(STL::reduce(std::begin(v1), std::begin(v1) + 2, 10) == 13);
+   REQUIRE(STL::reduce(std::begin(v1), std::end(v1), 1, std::multiplies<int>()) == 720);
+
+   std::list<int> l1(std::begin(v1), std::end(v1));
+   REQUIRE(STL::reduce(std::begin(l1), std::end(l1)) == 21);
+   REQUIRE(STL::reduce(STL::execution::par, std::begin(l1), std::end(l1), 4) == 25);
+
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 8 + 3;
+   std::vector<long long> v2(n);
+   for (auto i = 0; i < n; ++i) {
+      v2[i] = i;
+   }
+   const auto sum = static_cast<long long>(n) * (n - 1) / 2;
+   REQUIRE(STL::reduce(STL::execution::par, std::begin(v2), std::end(v2)) == sum);
+   REQUIRE(STL::reduce(STL::execution::seq, std::begin(v2), std::end(v2), 5ll) == sum + 5);
+   REQUIRE(STL::reduce(STL::execution::par_unseq, std::begin(v2), std::end(v2), std::numeric_limits<long long>::min(),
+                       [](long long a, long long b) { return a < b ? b : a; }) == n - 1);
+
+   std::vector<double> v3(n, 0.5);
+   REQUIRE(STL::reduce(STL::execution::par, std::begin(v3), std::end(v3), 0.0) == n * 0.5);
 }
 
 TEST_CASE("exclusive_scan", "[exclusive_scan]")
@@ -1072,6 +2094,52 @@ TEST_CASE("exclusive_scan", "[exclusive_scan]")
 
    REQUIRE(STL::inclusive_scan(std::begin(v1), std::end(v1), std::begin(v3)) == std::end(v3));
    REQUIRE(v3 == v4);
+
+   std::vector<int> v5(6, 0);
+   REQUIRE(STL::transform_exclusive_scan(std::begin(v1), std::end(v1), std::begin(v5), 0, std::plus<int>(), [](int i) { return i * 2; }) == std::end(v5));
+   REQUIRE(v5 == std::vector<int>({ 0, 2, 6, 12, 20, 30 }));
+   REQUIRE(STL::transform_inclusive_scan(std::begin(v1), std::end(v1), std::begin(v5), std::plus<int>(), [](int i) { return i * 2; }) == std::end(v5));
+   REQUIRE(v5 == std::vector<int>({ 2, 6, 12, 20, 30, 42 }));
+   REQUIRE(v1 == std::vector<int>({ 1, 2, 3, 4, 5, 6 }));
+
+   REQUIRE(STL::exclusive_scan(STL::execution::par, std::begin(v1), std::end(v1), std::begin(v3), 4) == std::end(v3));
+   REQUIRE(v3 == v2);
+   REQUIRE(STL::inclusive_scan(STL::execution::par, std::begin(v1), std::end(v1), std::begin(v3)) == std::end(v3));
+   REQUIRE(v3 == v4);
+
+   // Exercises the two-pass and the look-back scans, in place and out of place.
+   for (auto n : { static_cast<long long>(STL::parallel_cutoff) * 4 + 7, static_cast<long long>(STL::parallel_lookback_cutoff) + 11 }) {
+      std::vector<long long> in(static_cast<std::size_t>(n));
+      for (auto i = 0ll; i < n; ++i) {
+         in[i] = i % 13;
+      }
+      std::vector<long long> seq(in.size()), par(in.size());
+      STL::inclusive_scan(std::begin(in), std::end(in), std::begin(seq));
+      REQUIRE(STL::inclusive_scan(STL::execution::par, std::begin(in), std::end(in), std::begin(par)) == std::end(par));
+      REQUIRE(par == seq);
+
+      STL::exclusive_scan(std::begin(in), std::end(in), std::begin(seq), 3ll);
+      auto inplace = in;
+      REQUIRE(STL::exclusive_scan(STL::execution::par, std::begin(inplace), std::end(inplace), std::begin(inplace), 3ll) == std::end(inplace));
+      REQUIRE(inplace == seq);
+
+      STL::transform_inclusive_scan(std::begin(in), std::end(in), std::begin(seq), std::plus<long long>(), [](long long i) { return i * i; }, 1ll);
+      STL::transform_inclusive_scan(STL::execution::par_unseq, std::begin(in), std::end(in), std::begin(par), std::plus<long long>(), [](long long i) { return i * i; }, 1ll);
+      REQUIRE(par == seq);
+
+      STL::transform_exclusive_scan(std::begin(in), std::end(in), std::begin(seq), 0ll, std::plus<long long>(), [](long long i) { return i + 1; });
+      STL::transform_exclusive_scan(STL::execution::par, std::begin(in), std::end(in), std::begin(par), 0ll, std::plus<long long>(), [](long long i) { return i + 1; });
+      REQUIRE(par == seq);
+   }
+
+   // Scans only need associativity: string concatenation keeps the order.
+   std::vector<std::string> s1(STL::parallel_cutoff * 2, "a");
+   s1[0] = "b";
+   std::vector<std::string> s2(s1.size());
+   STL::inclusive_scan(STL::execution::par, std::begin(s1), std::end(s1), std::begin(s2), [](const std::string &a, const std::string &b) { return (a + b).substr(0, 3); });
+   REQUIRE(s2[0] == "b");
+   REQUIRE(s2[1] == "ba");
+   REQUIRE(s2.back() == "baa");
 }
 
 TEST_CASE("transform_reduce", "[transform_reduce]")
@@ -1080,6 +2148,227 @@ TEST_CASE("transform_reduce", "[transform_reduce]")
    std::vector<int> v2 = { 2, 2, 2, 3, 3, 3 };
 
    REQUIRE(STL::transform_reduce(std::begin(v1), std::end(v1), std::begin(v2), 4) == 61);
+   REQUIRE(STL::transform_reduce(STL::execution::par, std::begin(v1), std::end(v1), std::begin(v2), 4) == 61);
+   REQUIRE(STL::transform_reduce(std::begin(v1), std::end(v1), 0, std::plus<int>(), [](int i) { return i * i; }) == 91);
+
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 8 + 5;
+   std::vector<long long> v3(n), v4(n, 2);
+   for (auto i = 0; i < n; ++i) {
+      v3[i] = i;
+   }
+   const auto sum = static_cast<long long>(n) * (n - 1) / 2;
+   REQUIRE(STL::transform_reduce(STL::execution::par, std::begin(v3), std::end(v3), std::begin(v4), 1ll) == 2 * sum + 1);
+   REQUIRE(STL::transform_reduce(STL::execution::par, std::begin(v3), std::end(v3), 0ll, std::plus<long long>(),
+                                 [](long long i) { return i % 2; }) == n / 2);
+   REQUIRE(STL::transform_reduce(STL::execution::seq, std::begin(v3), std::end(v3), std::begin(v4), 0ll, std::plus<long long>(),
+                                 std::minus<long long>()) == sum - 2ll * n);
+}
+
+TEST_CASE("execution", "[execution]")
+{
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 8;
+   std::vector<int> v(n);
+   STL::generate(STL::execution::par, std::begin(v), std::end(v), [] { return 1; });
+   REQUIRE(STL::all_of(std::begin(v), std::end(v), [](int i) { return i == 1; }));
+
+   STL::for_each(STL::execution::par, std::begin(v), std::end(v), [](int &i) { ++i; });
+   REQUIRE(STL::count_if(STL::execution::par, std::begin(v), std::end(v), [](int i) { return i == 2; }) == n);
+   REQUIRE(STL::all_of(STL::execution::par, std::begin(v), std::end(v), [](int i) { return i == 2; }));
+   v[n / 2] = 0;
+   REQUIRE(!STL::all_of(STL::execution::par, std::begin(v), std::end(v), [](int i) { return i == 2; }));
+
+   std::vector<int> seq(n), par(n);
+   for (auto i = 0; i < n; ++i) {
+      v[i] = i;
+   }
+   REQUIRE(STL::transform(STL::execution::seq, std::begin(v), std::end(v), std::begin(seq), [](int i) { return i * 3; }) == std::end(seq));
+   REQUIRE(STL::transform(STL::execution::par, std::begin(v), std::end(v), std::begin(par), [](int i) { return i * 3; }) == std::end(par));
+   REQUIRE(seq == par);
+
+   REQUIRE(STL::transform(STL::execution::par_unseq, std::begin(v), std::end(v), std::begin(seq), std::begin(par), std::plus<int>()) == std::end(par));
+   REQUIRE(par[n - 1] == (n - 1) * 4);
+
+   STL::fill(STL::execution::par, std::begin(par), std::end(par), 7);
+   REQUIRE(STL::count_if(std::begin(par), std::end(par), [](int i) { return i == 7; }) == n);
+   REQUIRE(STL::copy(STL::execution::par, std::begin(v), std::end(v), std::begin(par)) == std::end(par));
+   REQUIRE(par == v);
+   REQUIRE(STL::for_each_n(STL::execution::par, std::begin(par), n / 2, [](int &i) { i = -1; }) == std::begin(par) + n / 2);
+   REQUIRE(par[n / 2 - 1] == -1);
+   REQUIRE(par[n / 2] == n / 2);
+
+   std::list<int> l(10, 1);
+   STL::for_each(STL::execution::par, std::begin(l), std::end(l), [](int &i) { i = 4; });
+   REQUIRE(STL::count_if(STL::execution::par, std::begin(l), std::end(l), [](int i) { return i == 4; }) == 10);
+
+   // Nested parallel calls from the pool workers must not deadlock.
+   std::vector<std::vector<int>> nested(16, std::vector<int>(n / 4));
+   STL::for_each(STL::execution::par, std::begin(nested), std::end(nested), [](std::vector<int> &inner) {
+      STL::fill(STL::execution::par, std::begin(inner), std::end(inner), 3);
+   });
+   for (const auto &inner : nested) {
+      REQUIRE(STL::count_if(std::begin(inner), std::end(inner), [](int i) { return i == 3; }) == n / 4);
+   }
+}
+
+TEST_CASE("compaction", "[compaction]")
+{
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 8 + 17;
+   std::vector<int> v(n);
+   for (auto i = 0; i < n; ++i) {
+      v[i] = (i * 7919) % 1000;
+   }
+   auto odd = [](int i) { return i % 2 == 1; };
+   auto small = [](int i) { return i < 100; };
+
+   std::vector<int> seq(n, -1), par(n, -1);
+   auto seq_end = STL::copy_if(std::begin(v), std::end(v), std::begin(seq), odd);
+   auto par_end = STL::copy_if(STL::execution::par, std::begin(v), std::end(v), std::begin(par), odd);
+   REQUIRE(par_end - std::begin(par) == seq_end - std::begin(seq));
+   REQUIRE(par == seq);
+
+   seq_end = STL::remove_copy_if(std::begin(v), std::end(v), std::begin(seq), small);
+   par_end = STL::remove_copy_if(STL::execution::par, std::begin(v), std::end(v), std::begin(par), small);
+   REQUIRE(par_end - std::begin(par) == seq_end - std::begin(seq));
+   REQUIRE(par == seq);
+
+   std::vector<int> none(n, 2);
+   REQUIRE(STL::copy_if(STL::execution::par, std::begin(none), std::end(none), std::begin(par), odd) == std::begin(par));
+
+   auto removed_seq = v;
+   auto removed_par = v;
+   auto seq_last = STL::remove_if(std::begin(removed_seq), std::end(removed_seq), odd);
+   auto par_last = STL::remove_if(STL::execution::par, std::begin(removed_par), std::end(removed_par), odd);
+   REQUIRE(par_last - std::begin(removed_par) == seq_last - std::begin(removed_seq));
+   REQUIRE(std::equal(std::begin(removed_par), par_last, std::begin(removed_seq)));
+   REQUIRE(STL::remove_if(STL::execution::par, std::begin(none), std::end(none), odd) == std::end(none));
+
+   auto stable = v;
+   auto expected = v;
+   std::stable_partition(std::begin(expected), std::end(expected), small);
+   auto mid = STL::stable_partition(STL::execution::par, std::begin(stable), std::end(stable), small);
+   REQUIRE(stable == expected);
+   REQUIRE(STL::all_of(std::begin(stable), mid, small));
+   REQUIRE(STL::none_of(mid, std::end(stable), small));
+
+   auto parted = v;
+   mid = STL::partition(STL::execution::par, std::begin(parted), std::end(parted), odd);
+   REQUIRE(STL::all_of(std::begin(parted), mid, odd));
+   REQUIRE(STL::none_of(mid, std::end(parted), odd));
+   REQUIRE(STL::partition(STL::execution::par, std::begin(none), std::end(none), [](int) { return true; }) == std::end(none));
+
+   std::vector<std::string> words(n / 4);
+   for (auto i = 0u; i < words.size(); ++i) {
+      words[i] = std::to_string(i);
+   }
+   auto expected_words = words;
+   auto has_seven = [](const std::string &w) { return w.find('7') != std::string::npos; };
+   std::stable_partition(std::begin(expected_words), std::end(expected_words), has_seven);
+   STL::partition(STL::execution::par, std::begin(words), std::end(words), has_seven);
+   REQUIRE(words == expected_words);
+
+   // Strings too long for the small buffer, so leaked or doubly destroyed
+   // buffer slots would show.
+   for (auto &w : words) {
+      w.insert(0, 32, '#');
+   }
+   auto removed_words = words;
+   expected_words = words;
+   expected_words.erase(std::remove_if(std::begin(expected_words), std::end(expected_words), has_seven), std::end(expected_words));
+   removed_words.erase(STL::remove_if(STL::execution::par, std::begin(removed_words), std::end(removed_words), has_seven), std::end(removed_words));
+   REQUIRE(removed_words == expected_words);
+}
+
+TEST_CASE("scheduler", "[scheduler]")
+{
+   STL::work_stealing_deque<int *> deque(2);
+   int items[5] = {};
+   for (auto &item : items) {
+      deque.push(&item);
+   }
+   REQUIRE(deque.steal() == &items[0]);
+   REQUIRE(deque.pop() == &items[4]);
+   REQUIRE(deque.steal() == &items[1]);
+   REQUIRE(deque.pop() == &items[3]);
+   REQUIRE(deque.pop() == &items[2]);
+   REQUIRE(deque.pop() == nullptr);
+   REQUIRE(deque.steal() == nullptr);
+   REQUIRE(deque.empty());
+
+   // Recursive spawns on a private scheduler, waiting threads help out.
+   STL::scheduler pool(3);
+   REQUIRE(pool.size() == 3);
+   std::function<long(int)> fib = [&](int k) -> long {
+      if (k < 2)
+         return k;
+      long a = 0;
+      STL::task_group group(pool);
+      group.spawn([&] { a = fib(k - 1); });
+      long b = fib(k - 2);
+      group.sync();
+      return a + b;
+   };
+   REQUIRE(fib(20) == 6765);
+
+   // More workers than the process has cpus are not pinned at all.
+   STL::scheduler pinned_pool(static_cast<unsigned>(STL::allowed_cpus().size()) + 1, true);
+   REQUIRE(!pinned_pool.pinned());
+   {
+      std::atomic<int> runs{ 0 };
+      STL::task_group group(pinned_pool);
+      for (auto i = 0; i < 16; ++i) {
+         group.spawn([&runs] { ++runs; });
+      }
+      group.sync();
+      REQUIRE(runs == 16);
+   }
+   REQUIRE(!STL::scheduler(1).pinned());
+
+   std::atomic<int> total{ 0 };
+   {
+      STL::task_group group;
+      for (auto i = 0; i < 64; ++i) {
+         group.spawn([&total] {
+            std::vector<int> v(STL::parallel_cutoff * 2, 1);
+            STL::for_each(STL::execution::par, std::begin(v), std::end(v), [](int &i) { i *= 2; });
+            total += static_cast<int>(STL::count_if(std::begin(v), std::end(v), [](int i) { return i == 2; }));
+         });
+      }
+   }
+   REQUIRE(total == 64 * STL::parallel_cutoff * 2);
+
+   const auto n = static_cast<int>(STL::parallel_cutoff) * 16;
+   std::mt19937 gen(7);
+   std::vector<int> random(n);
+   for (auto &i : random) {
+      i = static_cast<int>(gen() % 1000);
+   }
+   std::vector<int> skewed(n);
+   for (auto i = 0; i < n; ++i) {
+      skewed[i] = i % 7 == 0 ? static_cast<int>(gen()) : 0;
+   }
+   std::vector<int> organ(n);
+   for (auto i = 0; i < n; ++i) {
+      organ[i] = i < n / 2 ? i : n - i;
+   }
+
+   for (auto v : { random, skewed, organ }) {
+      auto expected = v;
+      std::sort(std::begin(expected), std::end(expected));
+      auto reversed = v;
+      STL::sort(STL::execution::par, std::begin(v), std::end(v));
+      REQUIRE(v == expected);
+      STL::sort(STL::execution::par, std::begin(reversed), std::end(reversed), std::greater<int>());
+      REQUIRE(std::equal(std::begin(reversed), std::end(reversed), expected.rbegin()));
+   }
+
+   std::vector<std::string> words(n / 4);
+   for (auto &word : words) {
+      word = std::to_string(gen());
+   }
+   auto expected = words;
+   std::sort(std::begin(expected), std::end(expected));
+   STL::sort(STL::execution::par, std::begin(words), std::end(words));
+   REQUIRE(words == expected);
 }
 
 #include "array.h"
@@ -1253,6 +2542,21 @@ TEST_CASE("array", "[array]")
    auto rit2 = rit - 1;
    REQUIRE(*rit2 == "test2");
    REQUIRE(rit2->size() == 5);
+
+   static_assert(STL::is_contiguous_iterator<STL::array<int, 5>::iterator>(), "STL::array::iterator is contiguous");
+   static_assert(STL::is_contiguous_iterator<STL::array<int, 5>::const_iterator>(), "STL::array::const_iterator is contiguous");
+   static_assert(!STL::is_contiguous_iterator<STL::array<int, 5>::reverse_iterator>(), "STL::array::reverse_iterator");
+   STL::array<std::uint16_t, 100> scan{};
+   scan[70] = 9;
+   scan[90] = 9;
+   REQUIRE(STL::find(scan.begin(), scan.end(), 9) == scan.begin() + 70);
+   REQUIRE(STL::count(scan.cbegin(), scan.cend(), 9) == 2);
+   STL::array<std::uint16_t, 100> scan2{};
+   REQUIRE(STL::copy(scan.cbegin(), scan.cend(), scan2.begin()) == scan2.end());
+   REQUIRE(STL::equal(scan.begin(), scan.end(), scan2.cbegin(), scan2.cend()));
+   scan2[80] = 1;
+   REQUIRE(STL::mismatch(scan.begin(), scan.end(), scan2.begin(), scan2.end()).first == scan.begin() + 80);
+   REQUIRE(STL::lexicographical_compare(scan.begin(), scan.end(), scan2.begin(), scan2.end()));
 }
 
 #include "optional.h"
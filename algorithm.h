@@ -1,10 +1,176 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+
+#include "execution.h"
+#include "simd.h"
 
 namespace STL {
+// Iterators that declare is_contiguous, like those of STL::array.
+template <typename T, typename = void>
+struct has_contiguous_marker : std::false_type {};
+
+template <typename T>
+struct has_contiguous_marker<T, std::void_t<decltype(T::is_contiguous)>>
+    : std::integral_constant<bool, T::is_contiguous> {};
+
+// Iterators known to address consecutive memory: pointers, iterators with a
+// contiguity marker and the iterators of std::vector (except vector<bool>),
+// std::basic_string and std::array.
+template <typename T> constexpr bool is_contiguous_iterator() {
+  if constexpr (std::is_pointer<T>::value) {
+    return true;
+  } else if constexpr (has_contiguous_marker<T>::value) {
+    return true;
+  } else {
+    using value_type = typename std::iterator_traits<T>::value_type;
+    if constexpr (std::is_same<value_type, bool>::value ||
+                  !std::is_object<value_type>::value) {
+      return false;
+    } else {
+      using vector = std::vector<value_type>;
+      using array = std::array<value_type, 1>;
+      bool result = std::is_same<T, typename vector::iterator>::value ||
+                    std::is_same<T, typename vector::const_iterator>::value ||
+                    std::is_same<T, typename array::iterator>::value ||
+                    std::is_same<T, typename array::const_iterator>::value;
+      if constexpr (std::is_same<value_type, char>::value ||
+                    std::is_same<value_type, wchar_t>::value ||
+                    std::is_same<value_type, char16_t>::value ||
+                    std::is_same<value_type, char32_t>::value) {
+        using string = std::basic_string<value_type>;
+        result = result ||
+                 std::is_same<T, typename string::iterator>::value ||
+                 std::is_same<T, typename string::const_iterator>::value;
+      }
+      return result;
+    }
+  }
+}
+
+template <typename T>
+using is_contiguous_it =
+    std::integral_constant<bool, is_contiguous_iterator<T>()>;
+
+// Address of the element it refers to; it must be dereferenceable.
+template <typename IT> auto to_pointer(IT it) noexcept {
+  return std::addressof(*it);
+}
+
+// Element and value types whose == the vector scans of find and count
+// reproduce: integers of any width, as the value converted to the element
+// type matches exactly the elements equal to the value whenever it still
+// equals the value, and floating point of the same type.
+template <typename ELEM, typename T>
+constexpr bool is_simd_scannable_v =
+    std::is_arithmetic<ELEM>::value && !std::is_same<ELEM, bool>::value &&
+    (sizeof(ELEM) == 1 || sizeof(ELEM) == 2 || sizeof(ELEM) == 4 ||
+     sizeof(ELEM) == 8) &&
+    ((std::is_integral<ELEM>::value && std::is_integral<T>::value &&
+      !std::is_same<T, bool>::value) ||
+     std::is_same<ELEM, T>::value);
+
+// Whether val converted to the element type still equals val, compared as
+// operator== compares them after the usual arithmetic conversions.
+template <typename ELEM, typename T>
+constexpr bool converts_exactly(ELEM elem, T val) noexcept {
+  using common_type = typename std::common_type<ELEM, T>::type;
+  return static_cast<common_type>(elem) == static_cast<common_type>(val);
+}
+
+// First element equal to val in [first, last). Bytes go to memchr, wider
+// types to the vector kernel of the processor.
+template <typename T>
+const T *simd_find(const T *first, const T *last, T val) noexcept {
+  if constexpr (sizeof(T) == 1) {
+    unsigned char byte;
+    std::memcpy(&byte, &val, 1);
+    auto found = std::memchr(first, byte, static_cast<std::size_t>(last - first));
+    return found ? static_cast<const T *>(found) : last;
+  } else {
+    static const auto kernel = simd::find_kernels<T>.resolve();
+    if (kernel)
+      return kernel(first, last, val);
+    for (; first != last; ++first) {
+      if (*first == val)
+        return first;
+    }
+    return last;
+  }
+}
+
+template <typename T>
+std::size_t simd_count(const T *first, const T *last, T val) noexcept {
+  static const auto kernel = simd::count_kernels<T>.resolve();
+  if (kernel)
+    return kernel(first, last, val);
+  std::size_t res = 0;
+  for (; first != last; ++first) {
+    res += *first == val;
+  }
+  return res;
+}
+
+// Contiguous ranges of the same element type that copy and move may transfer
+// with memmove, as assigning an element only copies its bytes.
+template <typename IT1, typename IT2, bool MOVE>
+constexpr bool is_memmove_transfer() {
+  if constexpr (is_contiguous_it<IT1>::value && is_contiguous_it<IT2>::value) {
+    using value_type1 = typename std::iterator_traits<IT1>::value_type;
+    using value_type2 = typename std::iterator_traits<IT2>::value_type;
+    return std::is_same<value_type1, value_type2>::value &&
+           (MOVE ? std::is_trivially_move_assignable<value_type1>::value
+                 : std::is_trivially_copy_assignable<value_type1>::value);
+  } else {
+    return false;
+  }
+}
+
+// Contiguous ranges of the same element type whose operator== compares the
+// object representations: integers, enumerations and pointers.
+template <typename IT1, typename IT2> constexpr bool is_bytewise_equal() {
+  if constexpr (is_contiguous_it<IT1>::value && is_contiguous_it<IT2>::value) {
+    using value_type1 = typename std::iterator_traits<IT1>::value_type;
+    using value_type2 = typename std::iterator_traits<IT2>::value_type;
+    return std::is_same<value_type1, value_type2>::value &&
+           (std::is_integral<value_type1>::value ||
+            std::is_enum<value_type1>::value ||
+            std::is_pointer<value_type1>::value);
+  } else {
+    return false;
+  }
+}
+
+// Index of the first of n elements at which a and b differ, n if there is
+// none; for the types of is_bytewise_equal only.
+template <typename T>
+std::size_t simd_mismatch(const T *a, const T *b, std::size_t n) noexcept {
+  static const auto kernel = simd::mismatch_kernels.resolve();
+  if (kernel)
+    return kernel(a, b, n * sizeof(T)) / sizeof(T);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (a[i] != b[i])
+      return i;
+  }
+  return n;
+}
+
+// Elements per block of the branch free predicate loop of any_of.
+constexpr std::size_t any_of_block = 64;
+
 template <typename IT, typename UNARY_PRED>
 bool all_of(IT first, IT last, UNARY_PRED &&pred) noexcept {
   while (first != last) {
@@ -15,22 +181,46 @@ bool all_of(IT first, IT last, UNARY_PRED &&pred) noexcept {
   return true;
 }
 
+// Over contiguous arithmetic ranges the predicate is applied to whole blocks
+// without branching, which compilers vectorize for simple predicates, and
+// the scan stops after the first block with a hit. Otherwise it stops at the
+// first hit.
 template <typename IT, typename UNARY_PRED>
 bool any_of(IT first, IT last, UNARY_PRED &&pred) noexcept {
-  bool bAnyOf = false;
-  while (first != last) {
-    bAnyOf |= pred(*first++);
+  using value_type = typename std::iterator_traits<IT>::value_type;
+  if constexpr (is_contiguous_it<IT>::value &&
+                std::is_arithmetic<value_type>::value) {
+    if (first == last)
+      return false;
+    auto data = STL::to_pointer(first);
+    auto n = static_cast<std::size_t>(last - first);
+    std::size_t i = 0;
+    for (; i + any_of_block <= n; i += any_of_block) {
+      // An unsigned accumulator vectorizes where a bool one does not.
+      unsigned hits = 0;
+      for (std::size_t j = 0; j < any_of_block; ++j) {
+        hits |= pred(data[i + j]) ? 1u : 0u;
+      }
+      if (hits)
+        return true;
+    }
+    for (; i < n; ++i) {
+      if (pred(data[i]))
+        return true;
+    }
+    return false;
+  } else {
+    for (; first != last; ++first) {
+      if (pred(*first))
+        return true;
+    }
+    return false;
   }
-  return bAnyOf;
 }
 
 template <typename IT, typename UNARY_PRED>
 bool none_of(IT first, IT last, UNARY_PRED &&pred) noexcept {
-  bool bNoneOf = true;
-  while (first != last) {
-    bNoneOf &= !pred(*first++);
-  }
-  return bNoneOf;
+  return !STL::any_of(first, last, std::forward<UNARY_PRED>(pred));
 }
 
 template <typename IT, typename UNARY_FUNC>
@@ -51,13 +241,24 @@ void for_each_n(IT first, SIZE n, UNARY_FUNC func) noexcept {
 template <typename IT, typename T>
 typename std::iterator_traits<IT>::difference_type count(IT first, IT end,
                                                          T val) noexcept {
-  auto res = typename std::iterator_traits<IT>::difference_type{};
-  while (first != end) {
-    if (*first++ == val) {
-      ++res;
+  using value_type = typename std::iterator_traits<IT>::value_type;
+  if constexpr (is_contiguous_it<IT>::value &&
+                is_simd_scannable_v<value_type, T>) {
+    auto elem = static_cast<value_type>(val);
+    if (first == end || !STL::converts_exactly(elem, val))
+      return 0;
+    auto data = STL::to_pointer(first);
+    return static_cast<typename std::iterator_traits<IT>::difference_type>(
+        STL::simd_count(data, data + (end - first), elem));
+  } else {
+    auto res = typename std::iterator_traits<IT>::difference_type{};
+    while (first != end) {
+      if (*first++ == val) {
+        ++res;
+      }
     }
+    return res;
   }
-  return res;
 }
 
 template <typename IT, typename UNARY_PRED>
@@ -74,6 +275,8 @@ count_if(IT first, IT end, UNARY_PRED pred) noexcept {
 
 template <typename IT1, typename IT2>
 std::pair<IT1, IT2> mismatch(IT1 begin1, IT1 end1, IT2 begin2) noexcept {
+  // Without the end of the second range only the elements up to the first
+  // difference are known to be there, so this one stays element by element.
   for (; begin1 != end1; ++begin1, ++begin2) {
     if (*begin1 != *begin2) {
       return {begin1, begin2};
@@ -85,12 +288,22 @@ std::pair<IT1, IT2> mismatch(IT1 begin1, IT1 end1, IT2 begin2) noexcept {
 template <typename IT1, typename IT2>
 std::pair<IT1, IT2> mismatch(IT1 begin1, IT1 end1, IT2 begin2,
                              IT2 end2) noexcept {
-  for (; begin1 != end1 && begin2 != end2; ++begin1, ++begin2) {
-    if (*begin1 != *begin2) {
+  if constexpr (is_bytewise_equal<IT1, IT2>()) {
+    auto n = end1 - begin1 < end2 - begin2 ? end1 - begin1 : end2 - begin2;
+    if (n == 0)
       return {begin1, begin2};
+    auto i = STL::simd_mismatch(STL::to_pointer(begin1),
+                                STL::to_pointer(begin2),
+                                static_cast<std::size_t>(n));
+    return {begin1 + i, begin2 + i};
+  } else {
+    for (; begin1 != end1 && begin2 != end2; ++begin1, ++begin2) {
+      if (*begin1 != *begin2) {
+        return {begin1, begin2};
+      }
     }
+    return {begin1, begin2};
   }
-  return {begin1, begin2};
 }
 
 template <typename IT1, typename IT2, typename BINARY_PRED>
@@ -122,30 +335,55 @@ bool equal(IT1 begin1, IT1 end1, IT2 begin2, IT2 end2) noexcept {
   if (std::distance(begin1, end1) != std::distance(begin2, end2))
     return false;
 
-  for (; begin1 != end1 && begin2 != end2; ++begin1, ++begin2) {
-    if (*begin1 != *begin2)
-      return false;
+  if constexpr (is_bytewise_equal<IT1, IT2>()) {
+    auto n = end1 - begin1;
+    return n == 0 ||
+           std::memcmp(STL::to_pointer(begin1), STL::to_pointer(begin2),
+                       static_cast<std::size_t>(n) * sizeof(*begin1)) == 0;
+  } else {
+    for (; begin1 != end1 && begin2 != end2; ++begin1, ++begin2) {
+      if (*begin1 != *begin2)
+        return false;
+    }
+    return true;
   }
-  return true;
 }
 
 template <typename IT1, typename IT2>
 bool equal(IT1 begin1, IT1 end1, IT2 begin2) noexcept {
-  for (; begin1 != end1; ++begin1, ++begin2) {
-    if (*begin1 != *begin2)
-      return false;
+  if constexpr (is_bytewise_equal<IT1, IT2>()) {
+    auto n = end1 - begin1;
+    return n == 0 ||
+           std::memcmp(STL::to_pointer(begin1), STL::to_pointer(begin2),
+                       static_cast<std::size_t>(n) * sizeof(*begin1)) == 0;
+  } else {
+    for (; begin1 != end1; ++begin1, ++begin2) {
+      if (*begin1 != *begin2)
+        return false;
+    }
+    return true;
   }
-  return true;
 }
 
 template <typename IT, typename T>
 IT find(IT begin, IT end, const T &val) noexcept {
-  for (; begin != end; ++begin) {
-    if (*begin == val) {
-      return begin;
+  using value_type = typename std::iterator_traits<IT>::value_type;
+  if constexpr (is_contiguous_it<IT>::value &&
+                is_simd_scannable_v<value_type, T>) {
+    // A value the elements cannot hold equals none of them.
+    auto elem = static_cast<value_type>(val);
+    if (begin == end || !STL::converts_exactly(elem, val))
+      return end;
+    auto data = STL::to_pointer(begin);
+    return begin + (STL::simd_find(data, data + (end - begin), elem) - data);
+  } else {
+    for (; begin != end; ++begin) {
+      if (*begin == val) {
+        return begin;
+      }
     }
+    return end;
   }
-  return end;
 }
 
 template <typename IT, typename UNARY_PRED>
@@ -164,20 +402,12 @@ IT find_if_not(IT begin, IT end, UNARY_PRED &&pred) {
                       [&pred](const auto &val) { return !pred(val); });
 }
 
-template <typename IT1, typename IT2>
-IT1 find_end(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s) noexcept {
-  return find_end(
-      begin, end, begin_s, end_s,
-      [](const auto &val1, const auto &val2) { return val1 == val2; });
-}
-
 template <typename IT1, typename IT2, typename BINARY_PRED>
-IT1 find_end(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
-             BINARY_PRED &&pred) noexcept {
+IT1 find_first_of(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
+                  BINARY_PRED &&pred) noexcept {
   if (begin_s == end_s)
     return end;
 
-  IT1 found = end;
   while (begin != end) {
     IT1 curr = begin;
     IT2 curr_s = begin_s;
@@ -185,59 +415,477 @@ IT1 find_end(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
       if (!pred(*curr, *curr_s)) {
         break;
       }
-      ++curr, ++curr_s;
+      ++curr_s, ++curr;
+
       if (curr_s == end_s) {
-        found = begin;
-        break;
+        return begin;
       }
     }
     ++begin;
   }
-
-  return found;
+  return end;
 }
 
 template <typename IT1, typename IT2>
 IT1 find_first_of(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s) noexcept {
-  return find_first_of(
+  return STL::find_first_of(
       begin, end, begin_s, end_s,
       [](const auto &val1, const auto &val2) { return val1 == val2; });
 }
 
+template <typename IT1, typename IT2>
+IT1 search(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s) noexcept {
+  return STL::find_first_of(begin, end, begin_s, end_s);
+}
+
 template <typename IT1, typename IT2, typename BINARY_PRED>
-IT1 find_first_of(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
-                  BINARY_PRED &&pred) noexcept {
-  if (begin_s == end_s)
-    return end;
+IT1 search(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
+           BINARY_PRED &&pred) noexcept {
+  return STL::find_first_of(begin, end, begin_s, end_s,
+                            std::forward<BINARY_PRED>(pred));
+}
 
-  while (begin != end) {
-    IT1 curr = begin;
-    IT2 curr_s = begin_s;
-    while (curr != end) {
-      if (!pred(*curr, *curr_s)) {
-        break;
+// Searches [begin, end) with a searcher object built for the pattern,
+// so that its tables are computed once and reused for every haystack.
+template <typename IT, typename SEARCHER>
+IT search(IT begin, IT end, const SEARCHER &searcher) {
+  return searcher(begin, end).first;
+}
+
+// Searcher running the element by element comparison of STL::search.
+template <class ForwardIt1, class BinaryPredicate = std::equal_to<>>
+class default_searcher {
+public:
+  default_searcher(ForwardIt1 pat_first, ForwardIt1 pat_last,
+                   BinaryPredicate pred = BinaryPredicate())
+      : pat_first_m(pat_first), pat_last_m(pat_last), pred_m(pred) {}
+
+  template <class ForwardIt2>
+  std::pair<ForwardIt2, ForwardIt2> operator()(ForwardIt2 first,
+                                               ForwardIt2 last) const {
+    if (pat_first_m == pat_last_m)
+      return {first, first};
+    auto found = STL::search(first, last, pat_first_m, pat_last_m, pred_m);
+    if (found == last)
+      return {last, last};
+    return {found, std::next(found, std::distance(pat_first_m, pat_last_m))};
+  }
+
+private:
+  ForwardIt1 pat_first_m;
+  ForwardIt1 pat_last_m;
+  BinaryPredicate pred_m;
+};
+
+// Bad character shifts of the Boyer-Moore searchers: how far the pattern may
+// move when an element is aligned with its last position. Bytes compared
+// with std::equal_to index a flat table, other keys go through a hash map.
+template <class Key, class Hash, class BinaryPredicate>
+constexpr bool has_flat_skip_table_v =
+    sizeof(Key) == 1 &&
+    (std::is_integral_v<Key> || std::is_same_v<Key, std::byte>) &&
+    std::is_same_v<Hash, std::hash<Key>> &&
+    (std::is_same_v<BinaryPredicate, std::equal_to<>> ||
+     std::is_same_v<BinaryPredicate, std::equal_to<Key>>);
+
+template <class Key, class Hash, class BinaryPredicate,
+          bool = has_flat_skip_table_v<Key, Hash, BinaryPredicate>>
+class searcher_skip_table {
+public:
+  searcher_skip_table(std::ptrdiff_t fallback, Hash hf, BinaryPredicate pred)
+      : fallback_m(fallback), table_m(0, hf, pred) {}
+
+  void set(const Key &key, std::ptrdiff_t shift) {
+    table_m.insert_or_assign(key, shift);
+  }
+  template <class T> std::ptrdiff_t operator[](const T &key) const {
+    auto it = table_m.find(key);
+    return it == table_m.end() ? fallback_m : it->second;
+  }
+
+private:
+  std::ptrdiff_t fallback_m;
+  std::unordered_map<Key, std::ptrdiff_t, Hash, BinaryPredicate> table_m;
+};
+
+template <class Key, class Hash, class BinaryPredicate>
+class searcher_skip_table<Key, Hash, BinaryPredicate, true> {
+public:
+  searcher_skip_table(std::ptrdiff_t fallback, Hash, BinaryPredicate) {
+    table_m.fill(fallback);
+  }
+
+  void set(Key key, std::ptrdiff_t shift) {
+    table_m[static_cast<unsigned char>(key)] = shift;
+  }
+  std::ptrdiff_t operator[](Key key) const {
+    return table_m[static_cast<unsigned char>(key)];
+  }
+
+private:
+  std::array<std::ptrdiff_t, 256> table_m;
+};
+
+// Boyer-Moore-Horspool: the pattern is compared from its end and moved by
+// the bad character shift of the element under its last position. Sublinear
+// on average, O(n * m) at worst.
+template <class RandomIt1,
+          class Hash =
+              std::hash<typename std::iterator_traits<RandomIt1>::value_type>,
+          class BinaryPredicate = std::equal_to<>>
+class boyer_moore_horspool_searcher {
+  using key_type = typename std::iterator_traits<RandomIt1>::value_type;
+
+public:
+  boyer_moore_horspool_searcher(RandomIt1 pat_first, RandomIt1 pat_last,
+                                Hash hf = Hash(),
+                                BinaryPredicate pred = BinaryPredicate())
+      : pat_first_m(pat_first), length_m(pat_last - pat_first), pred_m(pred),
+        shift_m(length_m, hf, pred) {
+    for (auto i = std::ptrdiff_t{}; i < length_m - 1; ++i) {
+      shift_m.set(pat_first[i], length_m - 1 - i);
+    }
+  }
+
+  template <class RandomIt2>
+  std::pair<RandomIt2, RandomIt2> operator()(RandomIt2 first,
+                                             RandomIt2 last) const {
+    auto m = length_m;
+    if (m == 0)
+      return {first, first};
+    auto n = static_cast<std::ptrdiff_t>(last - first);
+    for (auto pos = std::ptrdiff_t{}; n - pos >= m;) {
+      auto j = m - 1;
+      while (pred_m(first[pos + j], pat_first_m[j])) {
+        if (j == 0)
+          return {first + pos, first + pos + m};
+        --j;
       }
-      ++curr_s, ++curr;
+      pos += shift_m[first[pos + m - 1]];
+    }
+    return {last, last};
+  }
 
-      if (curr_s == end_s) {
-        return begin;
+private:
+  RandomIt1 pat_first_m;
+  std::ptrdiff_t length_m;
+  BinaryPredicate pred_m;
+  searcher_skip_table<key_type, Hash, BinaryPredicate> shift_m;
+};
+
+// Boyer-Moore: Horspool's bad character shift combined with the good suffix
+// shift, which moves the pattern past the matched suffix to its next
+// occurrence in the pattern. Both tables are built in O(m) (Charras and
+// Lecroq, Handbook of Exact String Matching Algorithms).
+template <class RandomIt1,
+          class Hash =
+              std::hash<typename std::iterator_traits<RandomIt1>::value_type>,
+          class BinaryPredicate = std::equal_to<>>
+class boyer_moore_searcher {
+  using key_type = typename std::iterator_traits<RandomIt1>::value_type;
+
+public:
+  boyer_moore_searcher(RandomIt1 pat_first, RandomIt1 pat_last,
+                       Hash hf = Hash(),
+                       BinaryPredicate pred = BinaryPredicate())
+      : pat_first_m(pat_first), length_m(pat_last - pat_first), pred_m(pred),
+        shift_m(length_m, hf, pred), good_suffix_m(length_m, length_m) {
+    auto m = length_m;
+    for (auto i = std::ptrdiff_t{}; i < m - 1; ++i) {
+      shift_m.set(pat_first[i], m - 1 - i);
+    }
+    if (m == 0)
+      return;
+
+    // suffix[i] is the length of the longest common suffix of the pattern
+    // and of its prefix ending at i.
+    std::vector<std::ptrdiff_t> suffix(m);
+    suffix[m - 1] = m;
+    auto f = m - 1;
+    auto g = m - 1;
+    for (auto i = m - 2; i >= 0; --i) {
+      if (i > g && suffix[i + m - 1 - f] < i - g) {
+        suffix[i] = suffix[i + m - 1 - f];
+      } else {
+        if (i < g)
+          g = i;
+        f = i;
+        while (g >= 0 && pred_m(pat_first[g], pat_first[g + m - 1 - f])) {
+          --g;
+        }
+        suffix[i] = f - g;
       }
     }
-    ++begin;
+
+    for (auto i = m - 1, j = std::ptrdiff_t{}; i >= 0; --i) {
+      if (suffix[i] == i + 1) {
+        for (; j < m - 1 - i; ++j) {
+          if (good_suffix_m[j] == m)
+            good_suffix_m[j] = m - 1 - i;
+        }
+      }
+    }
+    for (auto i = std::ptrdiff_t{}; i < m - 1; ++i) {
+      good_suffix_m[m - 1 - suffix[i]] = m - 1 - i;
+    }
+  }
+
+  template <class RandomIt2>
+  std::pair<RandomIt2, RandomIt2> operator()(RandomIt2 first,
+                                             RandomIt2 last) const {
+    auto m = length_m;
+    if (m == 0)
+      return {first, first};
+    auto n = static_cast<std::ptrdiff_t>(last - first);
+    for (auto pos = std::ptrdiff_t{}; n - pos >= m;) {
+      auto j = m - 1;
+      while (pred_m(first[pos + j], pat_first_m[j])) {
+        if (j == 0)
+          return {first + pos, first + pos + m};
+        --j;
+      }
+      auto bad_character = shift_m[first[pos + j]] - m + 1 + j;
+      pos += good_suffix_m[j] > bad_character ? good_suffix_m[j]
+                                              : bad_character;
+    }
+    return {last, last};
+  }
+
+private:
+  RandomIt1 pat_first_m;
+  std::ptrdiff_t length_m;
+  BinaryPredicate pred_m;
+  searcher_skip_table<key_type, Hash, BinaryPredicate> shift_m;
+  std::vector<std::ptrdiff_t> good_suffix_m;
+};
+
+// Crochemore-Perrin two-way matching for byte strings: linear time at worst
+// and constant extra space. The pattern is cut at a critical factorisation
+// found from its maximal suffixes; the right part is matched left to right,
+// then the left part right to left. As in musl, a window whose last byte
+// cannot end a match is first skipped by its bad character shift.
+template <class RandomIt1> class two_way_searcher {
+  using value_type = typename std::iterator_traits<RandomIt1>::value_type;
+  static_assert(sizeof(value_type) == 1 &&
+                    (std::is_integral_v<value_type> ||
+                     std::is_same_v<value_type, std::byte>),
+                "two_way_searcher works on byte strings");
+
+public:
+  two_way_searcher(RandomIt1 pat_first, RandomIt1 pat_last)
+      : pat_first_m(pat_first), length_m(pat_last - pat_first) {
+    shift_m.fill(length_m);
+    for (auto i = std::ptrdiff_t{}; i < length_m; ++i) {
+      shift_m[byte(i)] = length_m - 1 - i;
+    }
+    if (length_m == 0)
+      return;
+    std::ptrdiff_t period1, period2;
+    auto split1 = maximal_suffix(false, period1);
+    auto split2 = maximal_suffix(true, period2);
+    if (split1 > split2) {
+      split_m = split1;
+      period_m = period1;
+    } else {
+      split_m = split2;
+      period_m = period2;
+    }
+
+    // The pattern is periodic when its left part occurs again one period on.
+    periodic_m = period_m + split_m + 1 <= length_m;
+    for (auto i = std::ptrdiff_t{}; periodic_m && i <= split_m; ++i) {
+      periodic_m = byte(i) == byte(i + period_m);
+    }
+    if (!periodic_m) {
+      auto left = split_m + 1;
+      auto right = length_m - split_m - 1;
+      period_m = (left > right ? left : right) + 1;
+    }
+  }
+
+  template <class RandomIt2>
+  std::pair<RandomIt2, RandomIt2> operator()(RandomIt2 first,
+                                             RandomIt2 last) const {
+    auto m = length_m;
+    if (m == 0)
+      return {first, first};
+    auto n = static_cast<std::ptrdiff_t>(last - first);
+    auto text = [first](std::ptrdiff_t i) {
+      return static_cast<unsigned char>(first[i]);
+    };
+
+    // In a periodic pattern the prefix up to memory is known to match
+    // after a shift by the period.
+    auto memory = std::ptrdiff_t{-1};
+    for (auto pos = std::ptrdiff_t{}; n - pos >= m;) {
+      if (auto skip = shift_m[text(pos + m - 1)]) {
+        pos += skip;
+        memory = -1;
+        continue;
+      }
+      auto i = (split_m > memory ? split_m : memory) + 1;
+      while (i < m && byte(i) == text(pos + i)) {
+        ++i;
+      }
+      if (i < m) {
+        pos += i - split_m;
+        memory = -1;
+        continue;
+      }
+      auto low = periodic_m ? memory : std::ptrdiff_t{-1};
+      i = split_m;
+      while (i > low && byte(i) == text(pos + i)) {
+        --i;
+      }
+      if (i <= low)
+        return {first + pos, first + pos + m};
+      pos += period_m;
+      if (periodic_m)
+        memory = m - period_m - 1;
+    }
+    return {last, last};
+  }
+
+private:
+  unsigned char byte(std::ptrdiff_t i) const {
+    return static_cast<unsigned char>(pat_first_m[i]);
+  }
+
+  // Position before the maximal suffix of the pattern for byte order, or for
+  // the reverse order, and the period of that suffix.
+  std::ptrdiff_t maximal_suffix(bool reversed, std::ptrdiff_t &period) const {
+    auto start = std::ptrdiff_t{-1};
+    auto j = std::ptrdiff_t{};
+    auto k = std::ptrdiff_t{1};
+    period = 1;
+    while (j + k < length_m) {
+      auto a = byte(j + k);
+      auto b = byte(start + k);
+      if (reversed ? a > b : a < b) {
+        j += k;
+        k = 1;
+        period = j - start;
+      } else if (a == b) {
+        if (k != period) {
+          ++k;
+        } else {
+          j += period;
+          k = 1;
+        }
+      } else {
+        start = j;
+        j = start + 1;
+        k = period = 1;
+      }
+    }
+    return start;
+  }
+
+  RandomIt1 pat_first_m;
+  std::ptrdiff_t length_m;
+  std::ptrdiff_t split_m = -1;
+  std::ptrdiff_t period_m = 1;
+  bool periodic_m = false;
+  std::array<std::ptrdiff_t, 256> shift_m;
+};
+
+// Element by element search used by find_end on the reversed ranges. A
+// tight loop looks for the first element of the pattern and only a hit
+// starts comparing the rest.
+template <typename IT1, typename IT2, typename BINARY_PRED>
+IT1 search_reversed(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
+                    BINARY_PRED &pred) {
+  for (; begin != end; ++begin) {
+    if (!pred(*begin, *begin_s))
+      continue;
+    auto curr = begin;
+    auto curr_s = begin_s;
+    while (true) {
+      if (++curr_s == end_s)
+        return begin;
+      if (++curr == end)
+        return end;
+      if (!pred(*curr, *curr_s))
+        break;
+    }
   }
   return end;
 }
 
-template <typename IT1, typename IT2>
-IT1 search(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s) noexcept {
-  return find_first_of(begin, end, begin_s, end_s);
-}
+// Shortest pattern for which find_end over bytes runs a Horspool search;
+// below it building the skip table costs more than the shifts save.
+constexpr std::ptrdiff_t find_end_horspool_min = 4;
 
+// With bidirectional iterators the haystack is scanned from its end and the
+// first match found is returned, instead of walking the whole range for the
+// last one. Random access byte ranges compared with std::equal_to use a
+// Horspool search on the reversed ranges for longer patterns.
 template <typename IT1, typename IT2, typename BINARY_PRED>
-IT1 search(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
-           BINARY_PRED &&pred) noexcept {
-  return find_first_of(begin, end, begin_s, end_s,
-                       std::forward<BINARY_PRED>(pred));
+IT1 find_end(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s,
+             BINARY_PRED &&pred) noexcept {
+  if (begin_s == end_s)
+    return end;
+
+  using category1 = typename std::iterator_traits<IT1>::iterator_category;
+  using category2 = typename std::iterator_traits<IT2>::iterator_category;
+  if constexpr (std::is_base_of_v<std::bidirectional_iterator_tag,
+                                  category1> &&
+                std::is_base_of_v<std::bidirectional_iterator_tag,
+                                  category2>) {
+    using key_type = typename std::iterator_traits<IT2>::value_type;
+    using predicate = std::decay_t<BINARY_PRED>;
+    std::reverse_iterator<IT1> rbegin(end), rend(begin);
+    std::reverse_iterator<IT2> rbegin_s(end_s), rend_s(begin_s);
+    auto found = rend;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag,
+                                    category1> &&
+                  std::is_base_of_v<std::random_access_iterator_tag,
+                                    category2> &&
+                  std::is_same_v<
+                      typename std::iterator_traits<IT1>::value_type,
+                      key_type> &&
+                  has_flat_skip_table_v<key_type, std::hash<key_type>,
+                                        predicate>) {
+      if (end_s - begin_s >= find_end_horspool_min) {
+        found = STL::search(
+            rbegin, rend,
+            boyer_moore_horspool_searcher<std::reverse_iterator<IT2>,
+                                          std::hash<key_type>, predicate>(
+                rbegin_s, rend_s, std::hash<key_type>(), pred));
+      } else {
+        found = STL::search_reversed(rbegin, rend, rbegin_s, rend_s, pred);
+      }
+    } else {
+      found = STL::search_reversed(rbegin, rend, rbegin_s, rend_s, pred);
+    }
+    if (found == rend)
+      return end;
+    // The match ends at found; its first element is m places further on.
+    return std::next(found, std::distance(begin_s, end_s)).base();
+  } else {
+    IT1 found = end;
+    while (begin != end) {
+      IT1 curr = begin;
+      IT2 curr_s = begin_s;
+      while (curr != end) {
+        if (!pred(*curr, *curr_s)) {
+          break;
+        }
+        ++curr, ++curr_s;
+        if (curr_s == end_s) {
+          found = begin;
+          break;
+        }
+      }
+      ++begin;
+    }
+    return found;
+  }
+}
+
+template <typename IT1, typename IT2>
+IT1 find_end(IT1 begin, IT1 end, IT2 begin_s, IT2 end_s) noexcept {
+  return STL::find_end(begin, end, begin_s, end_s, std::equal_to<>());
 }
 
 template <typename IT, typename T, typename SIZE>
@@ -278,10 +926,18 @@ template <typename IT> IT adjacent_find(IT begin, IT end) {
 
 template <typename FORWARD_IT, typename OUTPUT_IT>
 OUTPUT_IT copy(FORWARD_IT begin, FORWARD_IT end, OUTPUT_IT begin_d) noexcept {
-  while (begin != end) {
-    *begin_d++ = *begin++;
+  if constexpr (is_memmove_transfer<FORWARD_IT, OUTPUT_IT, false>()) {
+    auto n = end - begin;
+    if (n > 0)
+      std::memmove(STL::to_pointer(begin_d), STL::to_pointer(begin),
+                   static_cast<std::size_t>(n) * sizeof(*begin));
+    return begin_d + n;
+  } else {
+    while (begin != end) {
+      *begin_d++ = *begin++;
+    }
+    return begin_d;
   }
-  return begin_d;
 }
 
 template <typename FORWARD_IT, typename OUTPUT_IT, typename UNARY_PRED>
@@ -298,34 +954,66 @@ OUTPUT_IT copy_if(FORWARD_IT begin, FORWARD_IT end, OUTPUT_IT begin_d,
 
 template <typename INPUTIT, typename SIZE, typename OUTPUTIT>
 OUTPUTIT copy_n(INPUTIT src, SIZE count, OUTPUTIT dest) noexcept {
-  for (auto ind = SIZE{}; ind < count; ++ind) {
-    *dest++ = *src++;
+  if constexpr (is_memmove_transfer<INPUTIT, OUTPUTIT, false>()) {
+    if (count <= SIZE{})
+      return dest;
+    std::memmove(STL::to_pointer(dest), STL::to_pointer(src),
+                 static_cast<std::size_t>(count) * sizeof(*src));
+    return dest + count;
+  } else {
+    for (auto ind = SIZE{}; ind < count; ++ind) {
+      *dest++ = *src++;
+    }
+    return dest;
   }
-  return dest;
 }
 
 template <typename BIDIT1, typename BIDIT2>
 BIDIT2 copy_backwards(BIDIT1 begin, BIDIT1 end, BIDIT2 end_d) noexcept {
-  while (begin != end) {
-    *--end_d = *--end;
+  if constexpr (is_memmove_transfer<BIDIT1, BIDIT2, false>()) {
+    auto n = end - begin;
+    if (n > 0)
+      std::memmove(STL::to_pointer(end_d - n), STL::to_pointer(begin),
+                   static_cast<std::size_t>(n) * sizeof(*begin));
+    return end_d - n;
+  } else {
+    while (begin != end) {
+      *--end_d = *--end;
+    }
+    return end_d;
   }
-  return end_d;
 }
 
 template <typename INPUTIT, typename OUTPUTIT>
 OUTPUTIT move(INPUTIT begin, INPUTIT end, OUTPUTIT begin_d) noexcept {
-  while (begin != end) {
-    *begin_d++ = std::move(*begin++);
+  if constexpr (is_memmove_transfer<INPUTIT, OUTPUTIT, true>()) {
+    auto n = end - begin;
+    if (n > 0)
+      std::memmove(STL::to_pointer(begin_d), STL::to_pointer(begin),
+                   static_cast<std::size_t>(n) * sizeof(*begin));
+    return begin_d + n;
+  } else {
+    while (begin != end) {
+      *begin_d++ = std::move(*begin++);
+    }
+    return begin_d;
   }
-  return begin_d;
 }
 
 template <typename BIDIRIT1, typename BIDIRIT2>
 BIDIRIT2 move_backwards(BIDIRIT1 begin, BIDIRIT1 end, BIDIRIT2 end_d) noexcept {
-  while (begin != end) {
-    *--end_d = std::move(*--end);
+  if constexpr (is_memmove_transfer<BIDIRIT1, BIDIRIT2, true>()) {
+    auto n = end - begin;
+    if (n > 0)
+      std::memmove(STL::to_pointer(end_d - n), STL::to_pointer(begin),
+                   static_cast<std::size_t>(n) * sizeof(*begin));
+    return end_d - n;
+  } else {
+    while (begin != end) {
+      *--end_d = std::move(*--end);
+    }
+    return end_d;
   }
-  return end_d;
 }
 
 template <typename ForwardIT, typename T>
@@ -392,12 +1080,11 @@ ForwardIt remove(ForwardIt first, ForwardIt last, const T &value) {
 
 template <class ForwardIt, class UnaryPredicate>
 ForwardIt remove_if(ForwardIt first, ForwardIt last, UnaryPredicate p) {
-  first = STL::find(first, last, p);
+  first = STL::find_if(first, last, p);
   if (first != last) {
-    for (auto i = first + 1; i != last; ++i) {
+    for (auto i = std::next(first); i != last; ++i) {
       if (!p(*i)) {
-        *first = std::move(*i);
-        first = i;
+        *first++ = std::move(*i);
       }
     }
   }
@@ -565,55 +1252,167 @@ OutputIt rotate_copy(ForwardIt first, ForwardIt n_first, ForwardIt last,
 
 template <class ForwardIt, class BinaryPredicate>
 ForwardIt unique(ForwardIt first, ForwardIt last, BinaryPredicate p) {
-  ForwardIt next = first;
-  while (first != last && ++next != last) {
-    if (p(*first++, *next)) {
-      last = STL::rotate(next, next + 1, last);
+  if (first == last)
+    return last;
+
+  ForwardIt result = first;
+  while (++first != last) {
+    if (!p(*result, *first) && ++result != first) {
+      *result = std::move(*first);
     }
   }
-  return last;
+  return ++result;
 }
 
-template <class InputIt, class UnaryPredicate>
-bool is_partitioned(InputIt first, InputIt last, UnaryPredicate p) {
-  while (first != last) {
-    if (!p(*first++))
-      break;
-  }
+template <class ForwardIt> ForwardIt unique(ForwardIt first, ForwardIt last) {
+  return STL::unique(
+      first, last,
+      [](const auto &val1, const auto &val2) { return val1 == val2; });
+}
 
-  while (first != last) {
-    if (p(*first++))
-      return false;
+template <class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt unique_copy(InputIt first, InputIt last, OutputIt d_first,
+                     BinaryPredicate p) {
+  if (first == last)
+    return d_first;
+
+  if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                typename std::iterator_traits<
+                                    InputIt>::iterator_category>::value) {
+    InputIt kept = first;
+    *d_first++ = *first;
+    while (++first != last) {
+      if (!p(*kept, *first)) {
+        kept = first;
+        *d_first++ = *first;
+      }
+    }
+  } else {
+    // A single pass input iterator cannot be revisited, so keep a copy of
+    // the last value written.
+    auto kept = typename std::iterator_traits<InputIt>::value_type(*first);
+    *d_first++ = kept;
+    while (++first != last) {
+      if (!p(kept, *first)) {
+        kept = *first;
+        *d_first++ = kept;
+      }
+    }
   }
-  return true;
+  return d_first;
 }
 
-template <typename T>
-using is_forward_it =
-    std::is_base_of<std::forward_iterator_tag,
-                    typename std::iterator_traits<T>::iterator_category>;
+template <class InputIt, class OutputIt>
+OutputIt unique_copy(InputIt first, InputIt last, OutputIt d_first) {
+  return STL::unique_copy(
+      first, last, d_first,
+      [](const auto &val1, const auto &val2) { return val1 == val2; });
+}
 
-template <typename T>
-using enable_if_forward_it = std::enable_if_t<is_forward_it<T>::value>;
+// Uninitialized scratch storage for the buffered algorithms. Allocation halves
+// the request until it succeeds, so size() may be smaller than requested, or
+// zero. The elements are move-constructed in a chain from *seed and the value
+// is moved back afterwards, so T does not have to be default constructible.
+template <typename T> class temporary_buffer {
+public:
+  template <typename IT>
+  temporary_buffer(IT seed, std::ptrdiff_t requested) {
+    constexpr auto max_size =
+        PTRDIFF_MAX / static_cast<std::ptrdiff_t>(sizeof(T));
+    if (requested > max_size)
+      requested = max_size;
+
+    while (requested > 0) {
+      data_m = static_cast<T *>(
+          ::operator new(requested * sizeof(T), std::nothrow));
+      if (data_m)
+        break;
+      requested /= 2;
+    }
+    if (!data_m)
+      return;
 
-template <class ForwardIt, class UnaryPredicate,
-          typename = enable_if_forward_it<ForwardIt>>
-ForwardIt partition(ForwardIt first, ForwardIt last, UnaryPredicate p) {
-  auto replaceIt = first;
-  for (; first != last; ++first) {
-    if (p(*first)) {
-      STL::iter_swap(first, replaceIt++);
+    size_m = requested;
+    ::new (static_cast<void *>(data_m)) T(std::move(*seed));
+    for (auto i = std::ptrdiff_t{1}; i < size_m; ++i) {
+      ::new (static_cast<void *>(data_m + i)) T(std::move(data_m[i - 1]));
     }
+    *seed = std::move(data_m[size_m - 1]);
   }
-  return replaceIt;
+
+  temporary_buffer(const temporary_buffer &) = delete;
+  temporary_buffer &operator=(const temporary_buffer &) = delete;
+
+  ~temporary_buffer() {
+    for (auto i = std::ptrdiff_t{}; i < size_m; ++i) {
+      data_m[i].~T();
+    }
+    ::operator delete(data_m);
+  }
+
+  T *data() const noexcept { return data_m; }
+  std::ptrdiff_t size() const noexcept { return size_m; }
+
+private:
+  T *data_m = nullptr;
+  std::ptrdiff_t size_m = 0;
+};
+
+// Storage for n elements that the buffer neither constructs nor destroys; the
+// algorithm using it keeps track of the slots holding objects. data() is null
+// if the allocation failed.
+template <typename T> class uninitialized_buffer {
+public:
+  explicit uninitialized_buffer(std::ptrdiff_t n) noexcept {
+    if (n > 0 && n <= PTRDIFF_MAX / static_cast<std::ptrdiff_t>(sizeof(T)))
+      data_m = static_cast<T *>(::operator new(n * sizeof(T), std::nothrow));
+  }
+
+  uninitialized_buffer(const uninitialized_buffer &) = delete;
+  uninitialized_buffer &operator=(const uninitialized_buffer &) = delete;
+
+  ~uninitialized_buffer() { ::operator delete(data_m); }
+
+  T *data() const noexcept { return data_m; }
+
+private:
+  T *data_m = nullptr;
+};
+
+template <class InputIt, class UnaryPredicate>
+bool is_partitioned(InputIt first, InputIt last, UnaryPredicate p) {
+  while (first != last) {
+    if (!p(*first++))
+      break;
+  }
+
+  while (first != last) {
+    if (p(*first++))
+      return false;
+  }
+  return true;
 }
 
-template <class BidirIt, class UnaryPredicate>
-BidirIt stable_partition(BidirIt first, BidirIt last, UnaryPredicate p) {
-  auto replaceIt = STL::find_if_not(first, last, p);
-  for (first = replaceIt; first != last; ++first) {
+template <typename T>
+using is_forward_it =
+    std::is_base_of<std::forward_iterator_tag,
+                    typename std::iterator_traits<T>::iterator_category>;
+
+template <typename T>
+using enable_if_forward_it = std::enable_if_t<is_forward_it<T>::value>;
+
+template <typename T>
+using is_random_access_it =
+    std::is_base_of<std::random_access_iterator_tag,
+                    typename std::iterator_traits<T>::iterator_category>;
+
+template <class ForwardIt, class UnaryPredicate,
+          typename = enable_if_forward_it<ForwardIt>>
+ForwardIt partition(ForwardIt first, ForwardIt last, UnaryPredicate p) {
+  auto replaceIt = first;
+  for (; first != last; ++first) {
     if (p(*first)) {
-      replaceIt = STL::rotate(replaceIt, first, first + 1);
+      STL::iter_swap(first, replaceIt++);
     }
   }
   return replaceIt;
@@ -635,6 +1434,61 @@ BidirIt stable_partition_rec(BidirIt first, BidirIt last, UnaryPredicate p) {
                      stable_partition_rec(mid, last, p));
 }
 
+// Requires !p(*first). Matches are compacted towards the front while misses
+// are moved out to the buffer, which is then moved back behind the matches.
+template <class BidirIt, class Pointer, class UnaryPredicate>
+BidirIt stable_partition_with_buffer(BidirIt first, BidirIt last,
+                                     Pointer buffer, UnaryPredicate p) {
+  auto result = first;
+  auto buffer_end = buffer;
+  *buffer_end++ = std::move(*first);
+  while (++first != last) {
+    if (p(*first)) {
+      *result++ = std::move(*first);
+    } else {
+      *buffer_end++ = std::move(*first);
+    }
+  }
+  STL::move(buffer, buffer_end, result);
+  return result;
+}
+
+// Partitions through the buffer when the range fits into it, otherwise splits
+// the range in halves and joins them with a rotation like
+// stable_partition_rec does.
+template <class BidirIt, class Distance, class Pointer, class UnaryPredicate>
+BidirIt stable_partition_adaptive(BidirIt first, BidirIt last, Pointer buffer,
+                                  Distance buffer_size, UnaryPredicate p) {
+  if (buffer_size == 0)
+    return STL::stable_partition_rec(first, last, p);
+
+  first = STL::find_if_not(first, last, p);
+  auto len = std::distance(first, last);
+  if (len == 0)
+    return first;
+
+  if (len <= buffer_size)
+    return STL::stable_partition_with_buffer(first, last, buffer, p);
+
+  auto mid = std::next(first, len / 2);
+  return STL::rotate(
+      STL::stable_partition_adaptive(first, mid, buffer, buffer_size, p), mid,
+      STL::stable_partition_adaptive(mid, last, buffer, buffer_size, p));
+}
+
+template <class BidirIt, class UnaryPredicate>
+BidirIt stable_partition(BidirIt first, BidirIt last, UnaryPredicate p) {
+  first = STL::find_if_not(first, last, p);
+  if (first == last)
+    return first;
+
+  auto len = std::distance(first, last);
+  using value_type = typename std::iterator_traits<BidirIt>::value_type;
+  STL::temporary_buffer<value_type> buffer(first, len);
+  return STL::stable_partition_adaptive(first, last, buffer.data(),
+                                        buffer.size(), p);
+}
+
 template <class ForwardIt, class UnaryPredicate>
 ForwardIt partition_point(ForwardIt first, ForwardIt last, UnaryPredicate p) {
   return STL::find_if_not(first, last, p);
@@ -785,19 +1639,582 @@ bool is_sorted(ForwardIt first, ForwardIt last, Compare comp) {
   return true;
 }
 
+template <class RandomIt, class Compare>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+  if (first == last)
+    return;
+
+  for (auto i = first + 1; i != last; ++i) {
+    auto val = std::move(*i);
+    if (comp(val, *first)) {
+      STL::move_backwards(first, i, i + 1);
+      *first = std::move(val);
+    } else {
+      auto hole = i;
+      for (auto prev = i - 1; comp(val, *prev); --prev) {
+        *hole = std::move(*prev);
+        hole = prev;
+      }
+      *hole = std::move(val);
+    }
+  }
+}
+
+// Requires an element before first that compares not greater than anything in
+// the range, which stops the inner loop without a bounds check.
+template <class RandomIt, class Compare>
+void unguarded_insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+  if (first == last)
+    return;
+
+  for (auto i = first + 1; i != last; ++i) {
+    if (comp(*i, *(i - 1))) {
+      auto val = std::move(*i);
+      auto hole = i;
+      for (auto prev = i - 1; comp(val, *prev); --prev) {
+        *hole = std::move(*prev);
+        hole = prev;
+      }
+      *hole = std::move(val);
+    }
+  }
+}
+
+// Insertion sort that gives up once it has moved more than a handful of
+// elements. Returns true if the range ended up sorted.
+template <class RandomIt, class Compare>
+bool partial_insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+  constexpr auto partial_insertion_sort_limit = 8;
+
+  if (first == last)
+    return true;
+
+  auto moved = typename std::iterator_traits<RandomIt>::difference_type{};
+  for (auto i = first + 1; i != last; ++i) {
+    if (comp(*i, *(i - 1))) {
+      auto val = std::move(*i);
+      auto hole = i;
+      do {
+        *hole = std::move(*(hole - 1));
+        --hole;
+      } while (hole != first && comp(val, *(hole - 1)));
+      *hole = std::move(val);
+
+      moved += i - hole;
+      if (moved > partial_insertion_sort_limit)
+        return false;
+    }
+  }
+  return true;
+}
+
+template <class RandomIt, class Compare>
+void sort3(RandomIt a, RandomIt b, RandomIt c, Compare comp) {
+  if (comp(*b, *a))
+    STL::iter_swap(a, b);
+  if (comp(*c, *b)) {
+    STL::iter_swap(b, c);
+    if (comp(*b, *a))
+      STL::iter_swap(a, b);
+  }
+}
+
+constexpr auto sort_ninther_threshold = 128;
+
+// Moves a median-of-3 (or, for large ranges, a ninther) pivot to *first. The
+// chosen samples leave an element >= pivot in (first, last), so the partition
+// loops below can scan forward without bounds checks.
+template <class RandomIt, class Compare>
+void move_pivot_to_first(RandomIt first, RandomIt last, Compare comp) {
+  auto size = last - first;
+  auto mid = first + size / 2;
+  if (size > sort_ninther_threshold) {
+    STL::sort3(first, mid, last - 1, comp);
+    STL::sort3(first + 1, mid - 1, last - 2, comp);
+    STL::sort3(first + 2, mid + 1, last - 3, comp);
+    STL::sort3(mid - 1, mid, mid + 1, comp);
+    STL::iter_swap(first, mid);
+  } else {
+    STL::sort3(mid, first, last - 1, comp);
+  }
+}
+
+// Partitions [first, last) around the pivot in *first into elements less than
+// the pivot followed by elements not less than it. Returns the final pivot
+// position and whether the range was already partitioned.
+template <class RandomIt, class Compare>
+std::pair<RandomIt, bool> partition_right(RandomIt first, RandomIt last,
+                                          Compare comp) {
+  auto pivot = std::move(*first);
+
+  auto lo = first;
+  auto hi = last;
+  while (comp(*++lo, pivot))
+    ;
+
+  if (lo - 1 == first) {
+    while (lo < hi && !comp(*--hi, pivot))
+      ;
+  } else {
+    while (!comp(*--hi, pivot))
+      ;
+  }
+
+  bool already_partitioned = lo >= hi;
+  while (lo < hi) {
+    STL::iter_swap(lo, hi);
+    while (comp(*++lo, pivot))
+      ;
+    while (!comp(*--hi, pivot))
+      ;
+  }
+
+  auto pivot_pos = lo - 1;
+  *first = std::move(*pivot_pos);
+  *pivot_pos = std::move(pivot);
+  return {pivot_pos, already_partitioned};
+}
+
+constexpr auto sort_block_size = 64;
+
+template <class RandomIt>
+void swap_offsets(RandomIt base_l, RandomIt base_r,
+                  const unsigned char *offsets_l,
+                  const unsigned char *offsets_r, size_t num, bool use_swaps) {
+  if (use_swaps) {
+    for (auto i = size_t{}; i < num; ++i) {
+      STL::iter_swap(base_l + offsets_l[i], base_r - offsets_r[i]);
+    }
+  } else if (num > 0) {
+    // Cyclic permutation: one move per misplaced element instead of a swap.
+    auto l = base_l + offsets_l[0];
+    auto r = base_r - offsets_r[0];
+    auto tmp = std::move(*l);
+    *l = std::move(*r);
+    for (auto i = size_t{1}; i < num; ++i) {
+      l = base_l + offsets_l[i];
+      *r = std::move(*l);
+      r = base_r - offsets_r[i];
+      *l = std::move(*r);
+    }
+    *r = std::move(tmp);
+  }
+}
+
+// Block partitioning after Edelkamp and Weiss: each side records the offsets
+// of misplaced elements in a small buffer using the comparison result as an
+// index increment, then the misplaced elements are swapped in bulk. No branch
+// depends on the outcome of a comparison, so random keys cost no
+// mispredictions. Same contract as partition_right.
+template <class RandomIt, class Compare>
+std::pair<RandomIt, bool> partition_right_branchless(RandomIt first,
+                                                     RandomIt last,
+                                                     Compare comp) {
+  auto pivot = std::move(*first);
+
+  auto lo = first;
+  auto hi = last;
+  while (comp(*++lo, pivot))
+    ;
+
+  if (lo - 1 == first) {
+    while (lo < hi && !comp(*--hi, pivot))
+      ;
+  } else {
+    while (!comp(*--hi, pivot))
+      ;
+  }
+
+  bool already_partitioned = lo >= hi;
+  if (!already_partitioned) {
+    STL::iter_swap(lo, hi);
+    ++lo;
+
+    alignas(64) unsigned char offsets_l[sort_block_size];
+    alignas(64) unsigned char offsets_r[sort_block_size];
+
+    auto base_l = lo;
+    auto base_r = hi;
+    size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+    while (lo < hi) {
+      size_t num_unknown = hi - lo;
+      size_t left_split =
+          num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+      size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+      if (left_split > sort_block_size)
+        left_split = sort_block_size;
+      for (size_t i = 0; i < left_split; ++i) {
+        offsets_l[num_l] = static_cast<unsigned char>(i);
+        num_l += !comp(*lo, pivot);
+        ++lo;
+      }
+
+      if (right_split > sort_block_size)
+        right_split = sort_block_size;
+      for (size_t i = 0; i < right_split;) {
+        offsets_r[num_r] = static_cast<unsigned char>(++i);
+        num_r += comp(*--hi, pivot);
+      }
+
+      auto num = num_l < num_r ? num_l : num_r;
+      STL::swap_offsets(base_l, base_r, offsets_l + start_l,
+                        offsets_r + start_r, num, num_l == num_r);
+      num_l -= num;
+      num_r -= num;
+      start_l += num;
+      start_r += num;
+
+      if (num_l == 0) {
+        start_l = 0;
+        base_l = lo;
+      }
+      if (num_r == 0) {
+        start_r = 0;
+        base_r = hi;
+      }
+    }
+
+    if (num_l) {
+      while (num_l--) {
+        STL::iter_swap(base_l + offsets_l[start_l + num_l], --hi);
+      }
+      lo = hi;
+    }
+    if (num_r) {
+      while (num_r--) {
+        STL::iter_swap(base_r - offsets_r[start_r + num_r], lo);
+        ++lo;
+      }
+    }
+  }
+
+  auto pivot_pos = lo - 1;
+  *first = std::move(*pivot_pos);
+  *pivot_pos = std::move(pivot);
+  return {pivot_pos, already_partitioned};
+}
+
+// Used when the pivot equals the element just before the range: every element
+// is then >= pivot, so those equal to it are gathered on the left and never
+// looked at again. Returns the end of the equal run.
+template <class RandomIt, class Compare>
+RandomIt partition_left(RandomIt first, RandomIt last, Compare comp) {
+  return STL::partition(first + 1, last, [&comp, first](const auto &val) {
+    return !comp(*first, val);
+  });
+}
+
+template <class RandomIt, class Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare comp) {
+  // The heap functions put the element that compares first at the root, so
+  // the comparison is reversed to leave the range in ascending order.
+  auto heap_comp = [&comp](const auto &a, const auto &b) { return comp(b, a); };
+  STL::make_heap(first, last, heap_comp);
+  STL::sort_heap(first, last, heap_comp);
+}
+
+// Breaks up patterns that produced an unbalanced partition by swapping a few
+// elements from the quartiles into the pivot sampling positions.
+template <class RandomIt>
+void shuffle_sort_samples(RandomIt first, RandomIt last) {
+  auto size = last - first;
+  STL::iter_swap(first, first + size / 4);
+  STL::iter_swap(last - 1, last - size / 4);
+  if (size > sort_ninther_threshold) {
+    STL::iter_swap(first + 1, first + (size / 4 + 1));
+    STL::iter_swap(first + 2, first + (size / 4 + 2));
+    STL::iter_swap(last - 2, last - (size / 4 + 1));
+    STL::iter_swap(last - 3, last - (size / 4 + 2));
+  }
+}
+
+template <typename T, typename Compare>
+struct is_branchless_compare : std::false_type {};
+
+template <typename T>
+struct is_branchless_compare<T, std::less<T>> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct is_branchless_compare<T, std::less<>> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct is_branchless_compare<T, std::greater<T>> : std::is_arithmetic<T> {};
+
+template <typename T>
+struct is_branchless_compare<T, std::greater<>> : std::is_arithmetic<T> {};
+
+// Partitions shorter than this are finished by insertion sort in pdqsort;
+// longer ones that end up badly unbalanced get their samples shuffled.
+constexpr std::ptrdiff_t pdqsort_insertion_sort_threshold = 24;
+
+// Pattern-defeating quicksort (Orson Peters). An introsort that also detects
+// already partitioned ranges, shuffles away adversarial patterns and only
+// falls back to heap sort after log2(n) badly unbalanced partitions.
+template <bool Branchless, class RandomIt, class Compare>
+void pdqsort_loop(RandomIt first, RandomIt last, Compare comp, int bad_allowed,
+                  bool leftmost = true) {
+  constexpr auto insertion_sort_threshold = pdqsort_insertion_sort_threshold;
+
+  while (true) {
+    auto size = last - first;
+
+    if (size < insertion_sort_threshold) {
+      if (leftmost)
+        STL::insertion_sort(first, last, comp);
+      else
+        STL::unguarded_insertion_sort(first, last, comp);
+      return;
+    }
+
+    STL::move_pivot_to_first(first, last, comp);
+
+    if (!leftmost && !comp(*(first - 1), *first)) {
+      first = STL::partition_left(first, last, comp);
+      continue;
+    }
+
+    auto part = Branchless ? STL::partition_right_branchless(first, last, comp)
+                           : STL::partition_right(first, last, comp);
+    auto pivot_pos = part.first;
+
+    auto l_size = pivot_pos - first;
+    auto r_size = last - (pivot_pos + 1);
+    bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+    if (highly_unbalanced) {
+      if (--bad_allowed == 0) {
+        STL::heap_sort(first, last, comp);
+        return;
+      }
+
+      if (l_size >= insertion_sort_threshold)
+        STL::shuffle_sort_samples(first, pivot_pos);
+      if (r_size >= insertion_sort_threshold)
+        STL::shuffle_sort_samples(pivot_pos + 1, last);
+    } else if (part.second &&
+               STL::partial_insertion_sort(first, pivot_pos, comp) &&
+               STL::partial_insertion_sort(pivot_pos + 1, last, comp)) {
+      return;
+    }
+
+    STL::pdqsort_loop<Branchless>(first, pivot_pos, comp, bad_allowed,
+                                  leftmost);
+    first = pivot_pos + 1;
+    leftmost = false;
+  }
+}
+
 template <class RandomIt, class Compare>
 void sort(RandomIt first, RandomIt last, Compare comp) {
   static_assert(
       std::is_base_of<std::random_access_iterator_tag,
                       std::iterator_traits<RandomIt>::iterator_category>::value,
       "Iterator needs to support random access");
-  STL::make_heap(first, last, comp);
-  STL::sort_heap(first, last, comp);
+
+  if (last - first < 2)
+    return;
+
+  auto log2_size = 0;
+  for (auto n = last - first; n > 1; n >>= 1) {
+    ++log2_size;
+  }
+
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::pdqsort_loop<is_branchless_compare<value_type, Compare>::value>(
+      first, last, comp, log2_size);
 }
 
 template <class RandomIt> void sort(RandomIt first, RandomIt last) {
   STL::sort(first, last,
-            std::greater<std::iterator_traits<RandomIt>::value_type>());
+            std::less<std::iterator_traits<RandomIt>::value_type>());
+}
+
+// Deterministic selection: medians of groups of five are gathered at the front
+// and their median, found recursively, is used as the pivot. Guarantees O(n)
+// regardless of the input, at a higher constant than introselect.
+template <class RandomIt, class Compare>
+void median_of_medians_select(RandomIt first, RandomIt nth, RandomIt last,
+                              Compare comp) {
+  constexpr auto group_size = 5;
+
+  while (last - first > group_size) {
+    auto medians_end = first;
+    for (auto group = first; group != last;) {
+      auto group_end = last - group > group_size ? group + group_size : last;
+      STL::insertion_sort(group, group_end, comp);
+      STL::iter_swap(medians_end++, group + (group_end - group) / 2);
+      group = group_end;
+    }
+
+    auto pivot = first + (medians_end - first) / 2;
+    STL::median_of_medians_select(first, pivot, medians_end, comp);
+    STL::iter_swap(first, pivot);
+
+    // Three-way split into less than, equal to and greater than the pivot so
+    // that runs of equal elements cannot stall the loop.
+    auto less_end = STL::partition(
+        first + 1, last,
+        [&comp, first](const auto &val) { return comp(val, *first); });
+    auto equal_end = STL::partition(
+        less_end, last,
+        [&comp, first](const auto &val) { return !comp(*first, val); });
+    STL::iter_swap(first, less_end - 1);
+
+    if (nth < less_end - 1) {
+      last = less_end - 1;
+    } else if (nth < equal_end) {
+      return;
+    } else {
+      first = equal_end;
+    }
+  }
+  STL::insertion_sort(first, last, comp);
+}
+
+// Introselect: quickselect on the pdqsort pivot and partition routines,
+// switching to median_of_medians_select if the ranges stop shrinking fast
+// enough.
+template <bool Branchless, class RandomIt, class Compare>
+void introselect(RandomIt first, RandomIt nth, RandomIt last, Compare comp) {
+  constexpr auto insertion_sort_threshold = 16;
+
+  auto depth_limit = 0;
+  for (auto n = last - first; n > 1; n >>= 1) {
+    depth_limit += 2;
+  }
+
+  auto leftmost = true;
+  while (last - first > insertion_sort_threshold) {
+    if (depth_limit-- == 0) {
+      STL::median_of_medians_select(first, nth, last, comp);
+      return;
+    }
+
+    STL::move_pivot_to_first(first, last, comp);
+
+    if (!leftmost && !comp(*(first - 1), *first)) {
+      auto equal_end = STL::partition_left(first, last, comp);
+      if (nth < equal_end)
+        return;
+      first = equal_end;
+      continue;
+    }
+
+    auto pivot_pos =
+        (Branchless ? STL::partition_right_branchless(first, last, comp)
+                    : STL::partition_right(first, last, comp))
+            .first;
+
+    if (pivot_pos == nth) {
+      return;
+    } else if (nth < pivot_pos) {
+      last = pivot_pos;
+    } else {
+      first = pivot_pos + 1;
+      leftmost = false;
+    }
+  }
+  STL::insertion_sort(first, last, comp);
+}
+
+template <class RandomIt, class Compare>
+void nth_element(RandomIt first, RandomIt nth, RandomIt last, Compare comp) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  if (nth == last || last - first < 2)
+    return;
+
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::introselect<is_branchless_compare<value_type, Compare>::value>(
+      first, nth, last, comp);
+}
+
+template <class RandomIt>
+void nth_element(RandomIt first, RandomIt nth, RandomIt last) {
+  STL::nth_element(
+      first, nth, last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+template <class RandomIt, class Compare>
+void partial_sort(RandomIt first, RandomIt middle, RandomIt last,
+                  Compare comp) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  auto k = middle - first;
+  if (k == 0)
+    return;
+
+  // Once a sizeable fraction of the range is wanted, selecting and sorting
+  // beats sifting most of the range through the heap.
+  if (k > (last - first) / 8) {
+    STL::nth_element(first, middle, last, comp);
+    STL::sort(first, middle, comp);
+    return;
+  }
+
+  // Keep the k smallest elements seen so far in a heap whose root is the
+  // largest of them; the heap functions take the reversed comparison for that.
+  auto heap_comp = [&comp](const auto &a, const auto &b) { return comp(b, a); };
+  STL::make_heap(first, middle, heap_comp);
+  for (auto it = middle; it != last; ++it) {
+    if (comp(*it, *first)) {
+      STL::iter_swap(it, first);
+      STL::heapify(first, decltype(k){}, k, heap_comp);
+    }
+  }
+  STL::sort_heap(first, middle, heap_comp);
+}
+
+template <class RandomIt>
+void partial_sort(RandomIt first, RandomIt middle, RandomIt last) {
+  STL::partial_sort(
+      first, middle, last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+template <class InputIt, class RandomIt, class Compare>
+RandomIt partial_sort_copy(InputIt first, InputIt last, RandomIt d_first,
+                           RandomIt d_last, Compare comp) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  auto d_middle = d_first;
+  while (first != last && d_middle != d_last) {
+    *d_middle++ = *first++;
+  }
+  auto k = d_middle - d_first;
+  if (k == 0)
+    return d_middle;
+
+  auto heap_comp = [&comp](const auto &a, const auto &b) { return comp(b, a); };
+  STL::make_heap(d_first, d_middle, heap_comp);
+  for (; first != last; ++first) {
+    if (comp(*first, *d_first)) {
+      *d_first = *first;
+      STL::heapify(d_first, decltype(k){}, k, heap_comp);
+    }
+  }
+  STL::sort_heap(d_first, d_middle, heap_comp);
+  return d_middle;
+}
+
+template <class InputIt, class RandomIt>
+RandomIt partial_sort_copy(InputIt first, InputIt last, RandomIt d_first,
+                           RandomIt d_last) {
+  return STL::partial_sort_copy(
+      first, last, d_first, d_last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
 }
 
 template <class ForwardIt, class T, class Compare>
@@ -943,10 +2360,203 @@ OutputIt merge(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
                     [](auto &v1, auto &v2) { return v1 < v2; });
 }
 
-template <class BidirIt>
-void inplace_merge(BidirIt first, BidirIt middle, BidirIt last) {
-  STL::inplace_merge(first, middle, last,
-                     std::less<std::iterator_traits<BidirIt>::value_type>{});
+// Merges k sorted ranges with a tournament tree of losers (Knuth, TAOCP
+// 5.4.1). Leaf i stands for ranges[i], every inner node keeps the range that
+// lost the match played there and the overall winner is written out. Only
+// the matches on the winner's path are replayed afterwards, so each element
+// costs about log2(k) comparisons and every input is read once. An
+// exhausted range loses every match. Equivalent elements are written in the
+// order of their ranges.
+template <class InputIt, class OutputIt, class Compare>
+OutputIt merge_k(const std::vector<std::pair<InputIt, InputIt>> &ranges,
+                 OutputIt d_first, Compare comp) {
+  auto k = ranges.size();
+  if (k == 0)
+    return d_first;
+  if (k == 1)
+    return STL::copy(ranges[0].first, ranges[0].second, d_first);
+
+  auto heads = ranges;
+  // Whether the head of range x goes before the head of range y.
+  auto beats = [&heads, &comp](std::size_t x, std::size_t y) {
+    if (heads[x].first == heads[x].second)
+      return false;
+    if (heads[y].first == heads[y].second)
+      return true;
+    return x < y ? !comp(*heads[y].first, *heads[x].first)
+                 : static_cast<bool>(comp(*heads[x].first, *heads[y].first));
+  };
+
+  // Node n has the children 2n and 2n + 1, leaf i is node k + i.
+  std::vector<std::size_t> losers(k);
+  {
+    std::vector<std::size_t> winners(2 * k);
+    for (auto i = std::size_t{}; i < k; ++i) {
+      winners[k + i] = i;
+    }
+    for (auto node = k - 1; node > 0; --node) {
+      auto left = winners[2 * node];
+      auto right = winners[2 * node + 1];
+      if (beats(left, right)) {
+        winners[node] = left;
+        losers[node] = right;
+      } else {
+        winners[node] = right;
+        losers[node] = left;
+      }
+    }
+    losers[0] = winners[1];
+  }
+
+  auto winner = losers[0];
+  while (heads[winner].first != heads[winner].second) {
+    *d_first++ = *heads[winner].first;
+    ++heads[winner].first;
+    for (auto node = (k + winner) / 2; node > 0; node /= 2) {
+      if (beats(losers[node], winner))
+        std::swap(losers[node], winner);
+    }
+  }
+  return d_first;
+}
+
+template <class InputIt, class OutputIt>
+OutputIt merge_k(const std::vector<std::pair<InputIt, InputIt>> &ranges,
+                 OutputIt d_first) {
+  return STL::merge_k(ranges, d_first, std::less<>());
+}
+
+template <class InputIt1, class InputIt2, class OutputIt, class Compare>
+OutputIt move_merge(InputIt1 first1, InputIt1 last1, InputIt2 first2,
+                    InputIt2 last2, OutputIt d_first, Compare comp) {
+  while (first1 != last1 && first2 != last2) {
+    if (comp(*first2, *first1)) {
+      *d_first++ = std::move(*first2++);
+    } else {
+      *d_first++ = std::move(*first1++);
+    }
+  }
+  d_first = STL::move(first1, last1, d_first);
+  return STL::move(first2, last2, d_first);
+}
+
+// Rotation based merge: split the longer run in half, find the matching cut
+// in the other run by binary search and rotate the middle sections into place.
+// O(n log n) moves without any extra memory.
+template <class BidirIt, class Distance, class Compare>
+void merge_without_buffer(BidirIt first, BidirIt middle, BidirIt last,
+                          Distance len1, Distance len2, Compare comp) {
+  if (len1 == 0 || len2 == 0)
+    return;
+
+  if (len1 + len2 == 2) {
+    if (comp(*middle, *first))
+      STL::iter_swap(first, middle);
+    return;
+  }
+
+  auto first_cut = first;
+  auto second_cut = middle;
+  auto len11 = Distance{};
+  auto len22 = Distance{};
+  if (len1 > len2) {
+    len11 = len1 / 2;
+    std::advance(first_cut, len11);
+    second_cut = STL::lower_bound(middle, last, *first_cut, comp);
+    len22 = std::distance(middle, second_cut);
+  } else {
+    len22 = len2 / 2;
+    std::advance(second_cut, len22);
+    first_cut = STL::upper_bound(first, middle, *second_cut, comp);
+    len11 = std::distance(first, first_cut);
+  }
+
+  auto new_middle = STL::rotate(first_cut, middle, second_cut);
+  STL::merge_without_buffer(first, first_cut, new_middle, len11, len22, comp);
+  STL::merge_without_buffer(new_middle, second_cut, last, len1 - len11,
+                            len2 - len22, comp);
+}
+
+// Merges the left run, which has been moved out to a buffer, with the right
+// run that is still in place, writing from the start of the left run.
+template <class Pointer, class BidirIt, class Compare>
+void merge_forward_from_buffer(Pointer buffer, Pointer buffer_end,
+                               BidirIt middle, BidirIt last, BidirIt d_first,
+                               Compare comp) {
+  while (buffer != buffer_end) {
+    if (middle == last) {
+      STL::move(buffer, buffer_end, d_first);
+      return;
+    }
+    if (comp(*middle, *buffer)) {
+      *d_first++ = std::move(*middle++);
+    } else {
+      *d_first++ = std::move(*buffer++);
+    }
+  }
+}
+
+// Mirror image of merge_forward_from_buffer: the right run is in the buffer
+// and the output is written backwards from the end of the range.
+template <class BidirIt, class Pointer, class Compare>
+void merge_backward_from_buffer(BidirIt first, BidirIt middle, Pointer buffer,
+                                Pointer buffer_end, BidirIt d_last,
+                                Compare comp) {
+  while (buffer != buffer_end) {
+    if (first == middle) {
+      STL::move_backwards(buffer, buffer_end, d_last);
+      return;
+    }
+    if (comp(*(buffer_end - 1), *(middle - 1))) {
+      *--d_last = std::move(*--middle);
+    } else {
+      *--d_last = std::move(*--buffer_end);
+    }
+  }
+}
+
+// Linear merge through the buffer when the shorter run fits into it,
+// otherwise splits both runs like merge_without_buffer until the pieces fit.
+template <class BidirIt, class Distance, class Pointer, class Compare>
+void merge_adaptive(BidirIt first, BidirIt middle, BidirIt last,
+                    Distance len1, Distance len2, Pointer buffer,
+                    Distance buffer_size, Compare comp) {
+  if (len1 == 0 || len2 == 0)
+    return;
+
+  if (buffer_size == 0) {
+    STL::merge_without_buffer(first, middle, last, len1, len2, comp);
+  } else if (len1 <= len2 && len1 <= buffer_size) {
+    auto buffer_end = STL::move(first, middle, buffer);
+    STL::merge_forward_from_buffer(buffer, buffer_end, middle, last, first,
+                                   comp);
+  } else if (len2 <= buffer_size) {
+    auto buffer_end = STL::move(middle, last, buffer);
+    STL::merge_backward_from_buffer(first, middle, buffer, buffer_end, last,
+                                    comp);
+  } else {
+    auto first_cut = first;
+    auto second_cut = middle;
+    auto len11 = Distance{};
+    auto len22 = Distance{};
+    if (len1 > len2) {
+      len11 = len1 / 2;
+      std::advance(first_cut, len11);
+      second_cut = STL::lower_bound(middle, last, *first_cut, comp);
+      len22 = std::distance(middle, second_cut);
+    } else {
+      len22 = len2 / 2;
+      std::advance(second_cut, len22);
+      first_cut = STL::upper_bound(first, middle, *second_cut, comp);
+      len11 = std::distance(first, first_cut);
+    }
+
+    auto new_middle = STL::rotate(first_cut, middle, second_cut);
+    STL::merge_adaptive(first, first_cut, new_middle, len11, len22, buffer,
+                        buffer_size, comp);
+    STL::merge_adaptive(new_middle, second_cut, last, len1 - len11,
+                        len2 - len22, buffer, buffer_size, comp);
+  }
 }
 
 template <class BidirIt, class Compare>
@@ -956,14 +2566,672 @@ void inplace_merge(BidirIt first, BidirIt middle, BidirIt last, Compare comp) {
                       std::iterator_traits<BidirIt>::iterator_category>::value,
       "Bidirectional iterator required");
 
-  while (middle != last) {
-    if (comp(*first, *middle)) {
-      ++first;
+  if (first == middle || middle == last)
+    return;
+
+  auto len1 = std::distance(first, middle);
+  auto len2 = std::distance(middle, last);
+
+  using value_type = typename std::iterator_traits<BidirIt>::value_type;
+  STL::temporary_buffer<value_type> buffer(first, len1 < len2 ? len1 : len2);
+  STL::merge_adaptive(first, middle, last, len1, len2, buffer.data(),
+                      decltype(len1){buffer.size()}, comp);
+}
+
+template <class BidirIt>
+void inplace_merge(BidirIt first, BidirIt middle, BidirIt last) {
+  STL::inplace_merge(first, middle, last,
+                     std::less<std::iterator_traits<BidirIt>::value_type>{});
+}
+
+constexpr auto stable_sort_chunk_size = 32;
+
+template <class RandomIt, class Compare>
+void insertion_sort_chunks(RandomIt first, RandomIt last, Compare comp) {
+  while (last - first > stable_sort_chunk_size) {
+    STL::insertion_sort(first, first + stable_sort_chunk_size, comp);
+    first += stable_sort_chunk_size;
+  }
+  STL::insertion_sort(first, last, comp);
+}
+
+template <class RandomIt, class OutputIt, class Distance, class Compare>
+void merge_sort_pass(RandomIt first, RandomIt last, OutputIt d_first,
+                     Distance step, Compare comp) {
+  while (last - first >= 2 * step) {
+    d_first = STL::move_merge(first, first + step, first + step,
+                              first + 2 * step, d_first, comp);
+    first += 2 * step;
+  }
+  auto mid = last - first > step ? first + step : last;
+  STL::move_merge(first, mid, mid, last, d_first, comp);
+}
+
+// Bottom-up merge sort that ping-pongs between the range and a buffer of the
+// same length.
+template <class RandomIt, class Pointer, class Compare>
+void merge_sort_with_buffer(RandomIt first, RandomIt last, Pointer buffer,
+                            Compare comp) {
+  auto len = last - first;
+  STL::insertion_sort_chunks(first, last, comp);
+
+  for (auto step = decltype(len){stable_sort_chunk_size}; step < len;
+       step *= 4) {
+    STL::merge_sort_pass(first, last, buffer, step, comp);
+    STL::merge_sort_pass(buffer, buffer + len, first, 2 * step, comp);
+  }
+}
+
+// Bottom-up merge sort for when only part of a full length buffer, or none at
+// all, could be allocated.
+template <class RandomIt, class Pointer, class Distance, class Compare>
+void merge_sort_adaptive(RandomIt first, RandomIt last, Pointer buffer,
+                         Distance buffer_size, Compare comp) {
+  auto len = last - first;
+  STL::insertion_sort_chunks(first, last, comp);
+
+  for (auto step = decltype(len){stable_sort_chunk_size}; step < len;
+       step *= 2) {
+    for (auto lo = decltype(len){}; len - lo > step; lo += 2 * step) {
+      auto hi = len - lo > 2 * step ? lo + 2 * step : len;
+      STL::merge_adaptive(first + lo, first + lo + step, first + hi, step,
+                          hi - lo - step, buffer, decltype(len){buffer_size},
+                          comp);
+    }
+  }
+}
+
+template <class RandomIt, class Compare>
+void inplace_stable_sort(RandomIt first, RandomIt last, Compare comp) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::merge_sort_adaptive(first, last, static_cast<value_type *>(nullptr),
+                           std::ptrdiff_t{}, comp);
+}
+
+template <class RandomIt, class Compare>
+void stable_sort(RandomIt first, RandomIt last, Compare comp) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  if (last - first < 2)
+    return;
+
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::temporary_buffer<value_type> buffer(first, last - first);
+  if (buffer.size() == last - first) {
+    STL::merge_sort_with_buffer(first, last, buffer.data(), comp);
+  } else {
+    STL::merge_sort_adaptive(first, last, buffer.data(), buffer.size(), comp);
+  }
+}
+
+template <class RandomIt> void stable_sort(RandomIt first, RandomIt last) {
+  STL::stable_sort(
+      first, last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+// Exponential search helpers for the galloping merge. The probes double in
+// distance from one end of the range until they overshoot the key, then the
+// last gap is finished with a binary search.
+template <class RandomIt, class T, class Compare>
+RandomIt gallop_lower_bound(RandomIt first, RandomIt last, const T &value,
+                            Compare comp) {
+  auto size = last - first;
+  auto prev = decltype(size){};
+  auto probe = decltype(size){};
+  while (probe < size && comp(first[probe], value)) {
+    prev = probe + 1;
+    probe = 2 * probe + 1;
+  }
+  return STL::lower_bound(first + prev, first + (probe < size ? probe : size),
+                          value, comp);
+}
+
+template <class RandomIt, class T, class Compare>
+RandomIt gallop_upper_bound(RandomIt first, RandomIt last, const T &value,
+                            Compare comp) {
+  auto size = last - first;
+  auto prev = decltype(size){};
+  auto probe = decltype(size){};
+  while (probe < size && !comp(value, first[probe])) {
+    prev = probe + 1;
+    probe = 2 * probe + 1;
+  }
+  return STL::upper_bound(first + prev, first + (probe < size ? probe : size),
+                          value, comp);
+}
+
+template <class RandomIt, class T, class Compare>
+RandomIt gallop_lower_bound_from_back(RandomIt first, RandomIt last,
+                                      const T &value, Compare comp) {
+  auto size = last - first;
+  auto prev = decltype(size){};
+  auto probe = decltype(size){1};
+  while (probe <= size && !comp(last[-probe], value)) {
+    prev = probe;
+    probe = 2 * probe + 1;
+  }
+  return STL::lower_bound(probe <= size ? last - probe + 1 : first,
+                          last - prev, value, comp);
+}
+
+template <class RandomIt, class T, class Compare>
+RandomIt gallop_upper_bound_from_back(RandomIt first, RandomIt last,
+                                      const T &value, Compare comp) {
+  auto size = last - first;
+  auto prev = decltype(size){};
+  auto probe = decltype(size){1};
+  while (probe <= size && comp(value, last[-probe])) {
+    prev = probe;
+    probe = 2 * probe + 1;
+  }
+  return STL::upper_bound(probe <= size ? last - probe + 1 : first,
+                          last - prev, value, comp);
+}
+
+constexpr auto timsort_min_gallop = 7;
+
+// Merge with the left run moved out to the buffer. Once one run has won
+// timsort_min_gallop times in a row, whole blocks are found by galloping and
+// moved at once.
+template <class RandomIt, class Pointer, class Compare>
+void gallop_merge_lo(RandomIt first, RandomIt middle, RandomIt last,
+                     Pointer buffer, Compare comp) {
+  auto buffer_end = STL::move(first, middle, buffer);
+  auto out = first;
+  auto wins_left = 0;
+  auto wins_right = 0;
+
+  while (buffer != buffer_end && middle != last) {
+    if (comp(*middle, *buffer)) {
+      *out++ = std::move(*middle++);
+      ++wins_right;
+      wins_left = 0;
+    } else {
+      *out++ = std::move(*buffer++);
+      ++wins_left;
+      wins_right = 0;
+    }
+
+    if ((wins_left >= timsort_min_gallop || wins_right >= timsort_min_gallop) &&
+        buffer != buffer_end && middle != last) {
+      auto buffer_cut =
+          STL::gallop_upper_bound(buffer, buffer_end, *middle, comp);
+      out = STL::move(buffer, buffer_cut, out);
+      buffer = buffer_cut;
+      if (buffer == buffer_end)
+        break;
+
+      auto right_cut = STL::gallop_lower_bound(middle, last, *buffer, comp);
+      out = STL::move(middle, right_cut, out);
+      middle = right_cut;
+      wins_left = wins_right = 0;
+    }
+  }
+  STL::move(buffer, buffer_end, out);
+}
+
+// Mirror image of gallop_merge_lo with the right run in the buffer, merging
+// from the back.
+template <class RandomIt, class Pointer, class Compare>
+void gallop_merge_hi(RandomIt first, RandomIt middle, RandomIt last,
+                     Pointer buffer, Compare comp) {
+  auto buffer_end = STL::move(middle, last, buffer);
+  auto out = last;
+  auto wins_left = 0;
+  auto wins_right = 0;
+
+  while (buffer != buffer_end && middle != first) {
+    if (comp(*(buffer_end - 1), *(middle - 1))) {
+      *--out = std::move(*--middle);
+      ++wins_left;
+      wins_right = 0;
+    } else {
+      *--out = std::move(*--buffer_end);
+      ++wins_right;
+      wins_left = 0;
+    }
+
+    if ((wins_left >= timsort_min_gallop || wins_right >= timsort_min_gallop) &&
+        buffer != buffer_end && middle != first) {
+      auto left_cut = STL::gallop_upper_bound_from_back(
+          first, middle, *(buffer_end - 1), comp);
+      out = STL::move_backwards(left_cut, middle, out);
+      middle = left_cut;
+      if (middle == first)
+        break;
+
+      auto buffer_cut = STL::gallop_lower_bound_from_back(
+          buffer, buffer_end, *(middle - 1), comp);
+      out = STL::move_backwards(buffer_cut, buffer_end, out);
+      buffer_end = buffer_cut;
+      wins_left = wins_right = 0;
+    }
+  }
+  STL::move_backwards(buffer, buffer_end, out);
+}
+
+template <class RandomIt, class Pointer, class Distance, class Compare>
+void timsort_merge(RandomIt first, RandomIt middle, RandomIt last,
+                   Pointer buffer, Distance buffer_size, Compare comp) {
+  // Elements of the left run not greater than the head of the right run, and
+  // elements of the right run not less than the tail of the left run, are
+  // already in place.
+  first = STL::gallop_upper_bound(first, middle, *middle, comp);
+  if (first == middle)
+    return;
+  last = STL::gallop_lower_bound_from_back(middle, last, *(middle - 1), comp);
+  if (middle == last)
+    return;
+
+  auto len1 = middle - first;
+  auto len2 = last - middle;
+  if (len1 <= len2 && len1 <= buffer_size) {
+    STL::gallop_merge_lo(first, middle, last, buffer, comp);
+  } else if (len2 <= buffer_size) {
+    STL::gallop_merge_hi(first, middle, last, buffer, comp);
+  } else {
+    STL::merge_adaptive(first, middle, last, len1, len2, buffer,
+                        decltype(len1){buffer_size}, comp);
+  }
+}
+
+// Length of the natural run at the start of the range. Strictly descending
+// runs are reversed in place, which keeps the sort stable.
+template <class RandomIt, class Compare>
+typename std::iterator_traits<RandomIt>::difference_type
+timsort_count_run(RandomIt first, RandomIt last, Compare comp) {
+  auto it = first + 1;
+  if (it == last)
+    return 1;
+
+  if (comp(*it, *first)) {
+    while (++it != last && comp(*it, *(it - 1)))
+      ;
+    STL::reverse(first, it);
+  } else {
+    while (++it != last && !comp(*it, *(it - 1)))
+      ;
+  }
+  return it - first;
+}
+
+template <class Distance> Distance timsort_min_run(Distance n) {
+  auto r = Distance{};
+  while (n >= 64) {
+    r |= n & 1;
+    n >>= 1;
+  }
+  return n + r;
+}
+
+// Natural merge sort after Tim Peters' listsort: existing runs are found and
+// extended to a minimum length with insertion sort, then kept on a stack whose
+// lengths grow at least like the Fibonacci numbers, so merges stay balanced.
+// Sorted and reverse sorted inputs take a single pass.
+template <class RandomIt, class Compare>
+void timsort(RandomIt first, RandomIt last, Compare comp) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  using difference_type =
+      typename std::iterator_traits<RandomIt>::difference_type;
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+  auto n = last - first;
+  if (n < 2)
+    return;
+
+  STL::temporary_buffer<value_type> buffer(first, n / 2);
+  auto min_run = STL::timsort_min_run(n);
+
+  struct run {
+    difference_type start;
+    difference_type length;
+  };
+  run runs[128];
+  auto stack_size = 0;
+
+  auto merge_at = [&](int i) {
+    auto run_first = first + runs[i].start;
+    auto run_middle = run_first + runs[i].length;
+    auto run_last = run_middle + runs[i + 1].length;
+    STL::timsort_merge(run_first, run_middle, run_last, buffer.data(),
+                       buffer.size(), comp);
+    runs[i].length += runs[i + 1].length;
+    if (i + 2 < stack_size)
+      runs[i + 1] = runs[i + 2];
+    --stack_size;
+  };
+
+  for (auto start = difference_type{}; start < n;) {
+    auto length = STL::timsort_count_run(first + start, last, comp);
+    if (length < min_run) {
+      auto forced = n - start < min_run ? n - start : min_run;
+      STL::insertion_sort(first + start, first + start + forced, comp);
+      length = forced;
+    }
+    runs[stack_size++] = {start, length};
+    start += length;
+
+    while (stack_size > 1) {
+      auto i = stack_size - 2;
+      if ((i > 0 &&
+           runs[i - 1].length <= runs[i].length + runs[i + 1].length) ||
+          (i > 1 &&
+           runs[i - 2].length <= runs[i - 1].length + runs[i].length)) {
+        if (runs[i - 1].length < runs[i + 1].length)
+          --i;
+        merge_at(i);
+      } else if (runs[i].length <= runs[i + 1].length) {
+        merge_at(i);
+      } else {
+        break;
+      }
+    }
+  }
+
+  while (stack_size > 1) {
+    auto i = stack_size - 2;
+    if (i > 0 && runs[i - 1].length < runs[i + 1].length)
+      --i;
+    merge_at(i);
+  }
+}
+
+template <class RandomIt> void timsort(RandomIt first, RandomIt last) {
+  STL::timsort(
+      first, last,
+      std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+// Maps an arithmetic key onto an unsigned integer of the same width whose
+// natural order matches the order of the key: signed integers get their sign
+// bit flipped, negative floats are inverted and positive ones get the sign
+// bit set. -0.0 is encoded as +0.0, as the two compare equal.
+template <typename T, typename = void> struct radix_key;
+
+template <typename T>
+struct radix_key<T, std::enable_if_t<std::is_integral<T>::value &&
+                                     !std::is_same<T, bool>::value>> {
+  using type = std::make_unsigned_t<T>;
+
+  static type encode(T val) noexcept {
+    auto bits = static_cast<type>(val);
+    if constexpr (std::is_signed<T>::value) {
+      bits ^= type{1} << (sizeof(T) * 8 - 1);
+    }
+    return bits;
+  }
+};
+
+template <typename T>
+struct radix_key<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  static_assert(sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t),
+                "Only 32 and 64 bit floating point keys are supported");
+
+  using type =
+      std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+
+  static type encode(T val) noexcept {
+    if (val == T{})
+      val = T{};
+    type bits;
+    std::memcpy(&bits, &val, sizeof(T));
+    constexpr auto sign = type{1} << (sizeof(T) * 8 - 1);
+    return (bits & sign) ? ~bits : (bits | sign);
+  }
+};
+
+constexpr auto radix_digit_bits = 8;
+constexpr auto radix_buckets = 1 << radix_digit_bits;
+
+// LSD radix sort with one 8 bit digit per pass. The histograms of all passes
+// are collected in a single read of the input and passes whose digit is the
+// same for every element are skipped. Elements ping-pong between the range
+// and the buffer, which must hold last - first elements.
+template <class RandomIt, class Pointer, class KeyFunc>
+void radix_sort_with_buffer(RandomIt first, RandomIt last, Pointer buffer,
+                            KeyFunc key) {
+  using key_traits = STL::radix_key<std::decay_t<decltype(key(*first))>>;
+  constexpr auto passes = sizeof(typename key_traits::type);
+
+  auto n = last - first;
+  decltype(n) counts[passes][radix_buckets] = {};
+  for (auto it = first; it != last; ++it) {
+    auto bits = key_traits::encode(key(*it));
+    for (auto pass = size_t{}; pass < passes; ++pass) {
+      ++counts[pass][(bits >> (pass * radix_digit_bits)) & (radix_buckets - 1)];
+    }
+  }
+
+  auto digit = [&key](const auto &val, size_t pass) {
+    return (key_traits::encode(key(val)) >> (pass * radix_digit_bits)) &
+           (radix_buckets - 1);
+  };
+
+  auto in_buffer = false;
+  for (auto pass = size_t{}; pass < passes; ++pass) {
+    auto &count = counts[pass];
+    if (STL::find(std::begin(count), std::end(count), n) != std::end(count))
+      continue;
+
+    decltype(n) offsets[radix_buckets];
+    auto offset = decltype(n){};
+    for (auto bucket = 0; bucket < radix_buckets; ++bucket) {
+      offsets[bucket] = offset;
+      offset += count[bucket];
+    }
+
+    if (in_buffer) {
+      for (auto it = buffer; it != buffer + n; ++it) {
+        first[offsets[digit(*it, pass)]++] = std::move(*it);
+      }
     } else {
-      first = STL::rotate(first, middle, middle + 1);
-      ++middle;
+      for (auto it = first; it != last; ++it) {
+        buffer[offsets[digit(*it, pass)]++] = std::move(*it);
+      }
     }
+    in_buffer = !in_buffer;
+  }
+
+  if (in_buffer) {
+    STL::move(buffer, buffer + n, first);
+  }
+}
+
+template <class RandomIt, class KeyFunc>
+void radix_sort_by_key(RandomIt first, RandomIt last, KeyFunc key) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  constexpr auto radix_sort_threshold = 64;
+
+  using key_traits = STL::radix_key<std::decay_t<decltype(key(*first))>>;
+  auto key_less = [&key](const auto &a, const auto &b) {
+    return key_traits::encode(key(a)) < key_traits::encode(key(b));
+  };
+
+  auto n = last - first;
+  if (n <= radix_sort_threshold) {
+    STL::insertion_sort(first, last, key_less);
+    return;
   }
+
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::temporary_buffer<value_type> buffer(first, n);
+  if (buffer.size() == n) {
+    STL::radix_sort_with_buffer(first, last, buffer.data(), key);
+  } else {
+    STL::stable_sort(first, last, key_less);
+  }
+}
+
+template <class RandomIt> void radix_sort(RandomIt first, RandomIt last) {
+  STL::radix_sort_by_key(first, last, [](const auto &val) { return val; });
+}
+
+// string_sort works on a compact index of the strings rather than on the
+// strings themselves: partitioning swaps 24 byte entries and reads the bytes
+// straight from the string data without going through the string object.
+struct string_sort_entry {
+  const unsigned char *data;
+  size_t size;
+  size_t index;
+};
+
+// Byte of the string at depth, shifted up by one so that the end of the string
+// (0) sorts before every real byte.
+inline int string_char_at(const string_sort_entry &entry,
+                          size_t depth) noexcept {
+  return depth < entry.size ? static_cast<int>(entry.data[depth]) + 1 : 0;
+}
+
+inline bool string_less_from(const string_sort_entry &a,
+                             const string_sort_entry &b,
+                             size_t depth) noexcept {
+  auto size = a.size < b.size ? a.size : b.size;
+  if (depth < size) {
+    auto res = std::memcmp(a.data + depth, b.data + depth, size - depth);
+    if (res != 0)
+      return res < 0;
+  }
+  return a.size < b.size;
+}
+
+// Length of the prefix shared by every string in the range, given that they
+// are already known to agree on the first depth bytes.
+inline size_t common_prefix_length(const string_sort_entry *first,
+                                   const string_sort_entry *last,
+                                   size_t depth) noexcept {
+  auto common = first->size;
+  for (auto it = first + 1; it != last && common > depth; ++it) {
+    auto size = it->size < common ? it->size : common;
+    auto pos = depth;
+    while (pos < size && it->data[pos] == first->data[pos])
+      ++pos;
+    common = pos;
+  }
+  return common > depth ? common : depth;
+}
+
+// Multikey quicksort (Bentley and Sedgewick): three-way partition on the byte
+// at depth, then sort the smaller and larger parts on the same byte and the
+// equal part on the next one. Every byte of a string is inspected once per
+// partitioning step instead of once per comparison from byte 0. When the
+// whole range agrees on a byte, the shared prefix is skipped in one pass.
+inline void multikey_quicksort(string_sort_entry *first,
+                               string_sort_entry *last, size_t depth) {
+  constexpr auto insertion_sort_threshold = 16;
+
+  while (last - first > insertion_sort_threshold) {
+    auto mid = first + (last - first) / 2;
+    auto a = STL::string_char_at(*first, depth);
+    auto b = STL::string_char_at(*mid, depth);
+    auto c = STL::string_char_at(*(last - 1), depth);
+    auto pivot = (a < b) ? (b < c ? b : (a < c ? c : a))
+                         : (a < c ? a : (b < c ? c : b));
+
+    auto lt = first;
+    auto gt = last;
+    for (auto it = first; it < gt;) {
+      auto ch = STL::string_char_at(*it, depth);
+      if (ch < pivot) {
+        STL::iter_swap(lt++, it++);
+      } else if (ch > pivot) {
+        STL::iter_swap(it, --gt);
+      } else {
+        ++it;
+      }
+    }
+
+    STL::multikey_quicksort(first, lt, depth);
+    STL::multikey_quicksort(gt, last, depth);
+    if (pivot == 0)
+      return;
+
+    if (lt == first && gt == last) {
+      depth = STL::common_prefix_length(first, last, depth + 1);
+    } else {
+      first = lt;
+      last = gt;
+      ++depth;
+    }
+  }
+
+  STL::insertion_sort(first, last,
+                      [depth](const auto &a, const auto &b) {
+                        return STL::string_less_from(a, b, depth);
+                      });
+}
+
+// Sorts a range of contiguous strings (std::string, std::string_view, ...) by
+// their bytes compared as unsigned char, which is the order std::string uses.
+// Falls back to STL::sort if the index cannot be allocated.
+template <class RandomIt> void string_sort(RandomIt first, RandomIt last) {
+  static_assert(
+      std::is_base_of<std::random_access_iterator_tag,
+                      std::iterator_traits<RandomIt>::iterator_category>::value,
+      "Iterator needs to support random access");
+
+  using char_type = std::remove_cv_t<
+      std::remove_pointer_t<decltype((*first).data())>>;
+  static_assert(sizeof(char_type) == 1,
+                "string_sort compares the strings byte by byte");
+
+  auto n = last - first;
+  if (n < 2)
+    return;
+
+  string_sort_entry seed{};
+  STL::temporary_buffer<string_sort_entry> entries(&seed, n);
+  if (entries.size() != n) {
+    STL::sort(first, last);
+    return;
+  }
+
+  auto index = entries.data();
+  for (auto i = decltype(n){}; i < n; ++i) {
+    const auto &str = first[i];
+    index[i] = {reinterpret_cast<const unsigned char *>(str.data()),
+                static_cast<size_t>(str.size()), static_cast<size_t>(i)};
+  }
+
+  STL::multikey_quicksort(index, index + n, 0);
+
+  // Apply the permutation by following its cycles, marking each visited
+  // position by pointing it at itself.
+  for (auto i = size_t{}; i < static_cast<size_t>(n); ++i) {
+    if (index[i].index == i)
+      continue;
+
+    auto tmp = std::move(first[i]);
+    auto hole = i;
+    while (index[hole].index != i) {
+      auto src = index[hole].index;
+      first[hole] = std::move(first[src]);
+      index[hole].index = hole;
+      hole = src;
+    }
+    first[hole] = std::move(tmp);
+    index[hole].index = hole;
+  }
+}
+
+// The set operations gallop through the larger of two random access ranges,
+// at O(small * log(large / small)) comparisons, once it is this many times
+// longer than the other one.
+constexpr std::ptrdiff_t set_gallop_ratio = 64;
+
+inline bool prefer_gallop(std::ptrdiff_t small, std::ptrdiff_t large) {
+  return small > 0 && large / small >= set_gallop_ratio;
 }
 
 template <class InputIt1, class InputIt2, class Compare>
@@ -979,15 +3247,25 @@ bool includes(InputIt1 first1, InputIt1 last1, InputIt2 first2, InputIt2 last2,
                       std::iterator_traits<InputIt2>::iterator_category>::value,
       "Input iterator required");
 
-  if (first2 == last2)
-    return true;
+  if constexpr (is_random_access_it<InputIt1>::value &&
+                is_random_access_it<InputIt2>::value) {
+    if (STL::prefer_gallop(last2 - first2, last1 - first1)) {
+      for (; first2 != last2; ++first2, ++first1) {
+        first1 = STL::gallop_lower_bound(first1, last1, *first2, comp);
+        if (first1 == last1 || comp(*first2, *first1))
+          return false;
+      }
+      return true;
+    }
+  }
 
-  while (first2 != last2 && first1 != last1) {
-    if (comp(*first1++, *first2)) {
+  for (; first2 != last2; ++first1) {
+    if (first1 == last1 || comp(*first2, *first1))
+      return false;
+    if (!comp(*first1, *first2))
       ++first2;
-    }
   }
-  return first2 == last2;
+  return true;
 }
 
 template <class InputIt1, class InputIt2>
@@ -995,10 +3273,7 @@ bool includes(InputIt1 first1, InputIt1 last1, InputIt2 first2,
               InputIt2 last2) {
   return STL::includes(
       first1, last1, first2, last2,
-      [](const std::iterator_traits<InputIt1>::value_type &val1,
-         const std::iterator_traits<InputIt2>::value_type &val2) {
-        return val1 == val2;
-      });
+      [](const auto &val1, const auto &val2) { return val1 < val2; });
 }
 
 template <class InputIt1, class InputIt2, class OutputIt, class Compare>
@@ -1014,6 +3289,35 @@ OutputIt set_difference(InputIt1 first1, InputIt1 last1, InputIt2 first2,
                       std::iterator_traits<InputIt2>::iterator_category>::value,
       "Input iterator required");
 
+  if constexpr (is_random_access_it<InputIt1>::value &&
+                is_random_access_it<InputIt2>::value) {
+    if (STL::prefer_gallop(last1 - first1, last2 - first2)) {
+      while (first1 != last1 && first2 != last2) {
+        first2 = STL::gallop_lower_bound(first2, last2, *first1, comp);
+        if (first2 == last2)
+          break;
+        if (comp(*first1, *first2))
+          *d_first++ = *first1;
+        ++first1;
+      }
+      return STL::copy(first1, last1, d_first);
+    }
+    if (STL::prefer_gallop(last2 - first2, last1 - first1)) {
+      while (first1 != last1 && first2 != last2) {
+        auto run_end = STL::gallop_lower_bound(first1, last1, *first2, comp);
+        d_first = STL::copy(first1, run_end, d_first);
+        first1 = run_end;
+        if (first1 == last1)
+          break;
+        if (comp(*first2, *first1))
+          ++first2;
+        else
+          ++first1;
+      }
+      return STL::copy(first1, last1, d_first);
+    }
+  }
+
   while (first1 != last1) {
     if (first2 == last2) {
       d_first = STL::copy(first1, last1, d_first);
@@ -1042,6 +3346,67 @@ OutputIt set_difference(InputIt1 first1, InputIt1 last1, InputIt2 first2,
       [](const auto &val1, const auto &val2) { return val1 < val2; });
 }
 
+// Whether Compare is std::less over T itself. A std::less of another type
+// converts the elements first and may order them differently from T's own <.
+template <class T, class Compare>
+struct is_less_compare
+    : std::integral_constant<bool,
+                             std::is_same<Compare, std::less<>>::value ||
+                                 std::is_same<Compare, std::less<T>>::value> {
+};
+
+// Intersection of two increasing integer ranges through the
+// simd::intersect_kernel the processor supports. The kernel output goes to a
+// buffer on the stack and a slice of a at a time, so any output iterator
+// works. When the kernel stops at a duplicate a few scalar steps move past
+// it and the kernel takes over again; the scalar loop finishes the last
+// block.
+template <class T, class OutputIt>
+OutputIt simd_set_intersection(const T *a, std::size_t na, const T *b,
+                               std::size_t nb, OutputIt d_first) {
+  auto scalar_step = [&] {
+    if (*a < *b) {
+      ++a, --na;
+    } else {
+      if (!(*b < *a)) {
+        *d_first++ = *a;
+        ++a, --na;
+      }
+      ++b, --nb;
+    }
+  };
+
+  constexpr std::size_t slice = 1024;
+  // Elements in a block of the widest kernel.
+  constexpr std::size_t block = 32 / sizeof(T);
+  static const auto kernel = simd::intersect_kernels<T>.resolve();
+  if (kernel) {
+    T buffer[slice + block];
+    while (na > block && nb > block) {
+      std::size_t ia = 0, ib = 0;
+      auto k = kernel(a, na < slice ? na : slice, b, nb, buffer, &ia, &ib);
+      d_first = STL::copy(buffer, buffer + k, d_first);
+      a += ia;
+      na -= ia;
+      b += ib;
+      nb -= ib;
+      // With enough elements left only a duplicate in the next block of
+      // either range stops the kernel before it starts.
+      if (ia == 0 && ib == 0) {
+        for (auto steps = 2 * (block + 1); steps != 0 && na != 0 && nb != 0;
+             --steps) {
+          scalar_step();
+        }
+      }
+    }
+  }
+
+  while (na != 0 && nb != 0) {
+    scalar_step();
+  }
+  return d_first;
+}
+
 template <class InputIt1, class InputIt2, class OutputIt, class Compare>
 OutputIt set_intersection(InputIt1 first1, InputIt1 last1, InputIt2 first2,
                           InputIt2 last2, OutputIt d_first, Compare comp) {
@@ -1056,6 +3421,44 @@ OutputIt set_intersection(InputIt1 first1, InputIt1 last1, InputIt2 first2,
                       std::iterator_traits<InputIt2>::iterator_category>::value,
       "Input iterator required");
 
+  if constexpr (is_random_access_it<InputIt1>::value &&
+                is_random_access_it<InputIt2>::value) {
+    if (STL::prefer_gallop(last2 - first2, last1 - first1)) {
+      for (; first1 != last1 && first2 != last2; ++first2) {
+        first1 = STL::gallop_lower_bound(first1, last1, *first2, comp);
+        if (first1 != last1 && !comp(*first2, *first1))
+          *d_first++ = *first1++;
+      }
+      return d_first;
+    }
+    if (STL::prefer_gallop(last1 - first1, last2 - first2)) {
+      for (; first1 != last1 && first2 != last2; ++first1) {
+        first2 = STL::gallop_lower_bound(first2, last2, *first1, comp);
+        if (first2 != last2 && !comp(*first1, *first2)) {
+          *d_first++ = *first1;
+          ++first2;
+        }
+      }
+      return d_first;
+    }
+  }
+
+  using value_type1 = typename std::iterator_traits<InputIt1>::value_type;
+  using value_type2 = typename std::iterator_traits<InputIt2>::value_type;
+  if constexpr (is_contiguous_it<InputIt1>::value &&
+                is_contiguous_it<InputIt2>::value &&
+                std::is_same<value_type1, value_type2>::value &&
+                std::is_integral<value_type1>::value &&
+                (sizeof(value_type1) == 4 || sizeof(value_type1) == 8) &&
+                is_less_compare<value_type1, Compare>::value) {
+    if (first1 == last1 || first2 == last2)
+      return d_first;
+    return STL::simd_set_intersection(
+        STL::to_pointer(first1), static_cast<std::size_t>(last1 - first1),
+        STL::to_pointer(first2), static_cast<std::size_t>(last2 - first2),
+        d_first);
+  }
+
   while (first1 != last1 && first2 != last2) {
     if (comp(*first1, *first2)) {
       ++first1;
@@ -1072,9 +3475,8 @@ OutputIt set_intersection(InputIt1 first1, InputIt1 last1, InputIt2 first2,
 template <class InputIt1, class InputIt2, class OutputIt>
 OutputIt set_intersection(InputIt1 first1, InputIt1 last1, InputIt2 first2,
                           InputIt2 last2, OutputIt d_first) {
-  return STL::set_intersection(
-      first1, last1, first2, last2,
-      d_first, [](const auto &v1, const auto &v2) noexcept { return v1 < v2; });
+  return STL::set_intersection(first1, last1, first2, last2, d_first,
+                               std::less<>());
 }
 
 template <class InputIt1, class InputIt2, class OutputIt, class Compare>
@@ -1249,6 +3651,37 @@ OutputIt partial_sum(InputIt first, InputIt last, OutputIt d_first) {
       [](const auto &val1, const auto &val2) { return val1 + val2; });
 }
 
+// Folds elem(0), ..., elem(n - 1) into init using four independent
+// accumulators. That splits the dependency chain of the fold four ways, so
+// additions overlap in the pipeline and integer loops vectorize. Relies on
+// binary_op being associative and commutative, as reduce may.
+template <class T, class BinaryOp, class Elem>
+T unrolled_reduce(std::ptrdiff_t n, T init, BinaryOp &binary_op, Elem &&elem) {
+  if (n < 8) {
+    for (auto i = std::ptrdiff_t{}; i < n; ++i) {
+      init = binary_op(init, elem(i));
+    }
+    return init;
+  }
+
+  T acc0 = elem(0);
+  T acc1 = elem(1);
+  T acc2 = elem(2);
+  T acc3 = elem(3);
+  auto i = std::ptrdiff_t{4};
+  for (; i + 4 <= n; i += 4) {
+    acc0 = binary_op(acc0, elem(i));
+    acc1 = binary_op(acc1, elem(i + 1));
+    acc2 = binary_op(acc2, elem(i + 2));
+    acc3 = binary_op(acc3, elem(i + 3));
+  }
+  for (; i < n; ++i) {
+    acc0 = binary_op(acc0, elem(i));
+  }
+  return binary_op(init, binary_op(binary_op(acc0, acc1),
+                                   binary_op(acc2, acc3)));
+}
+
 template <class InputIt, class T, class BinaryOp>
 T reduce(InputIt first, InputIt last, T init, BinaryOp binary_op) {
   static_assert(
@@ -1260,11 +3693,16 @@ T reduce(InputIt first, InputIt last, T init, BinaryOp binary_op) {
       std::is_convertible<std::iterator_traits<InputIt>::value_type, T>::value,
       "incompatible T and InputIt");
 
-  auto res = init;
-  while (first != last) {
-    res = binary_op(res, *first++);
+  if constexpr (is_random_access_it<InputIt>::value) {
+    return STL::unrolled_reduce(last - first, init, binary_op,
+                                [first](std::ptrdiff_t i) { return first[i]; });
+  } else {
+    auto res = init;
+    while (first != last) {
+      res = binary_op(res, *first++);
+    }
+    return res;
   }
-  return res;
 }
 
 template <class InputIt, class T>
@@ -1338,11 +3776,17 @@ T transform_reduce(InputIt first, InputIt last, T init, BinaryOp binop,
                       std::iterator_traits<InputIt>::iterator_category>::value,
       "Input iterator required");
 
-  auto val = init;
-  while (first != last) {
-    val = binop(val, unary_op(*first++));
+  if constexpr (is_random_access_it<InputIt>::value) {
+    return STL::unrolled_reduce(
+        last - first, init, binop,
+        [first, &unary_op](std::ptrdiff_t i) { return unary_op(first[i]); });
+  } else {
+    auto val = init;
+    while (first != last) {
+      val = binop(val, unary_op(*first++));
+    }
+    return val;
   }
-  return val;
 }
 
 template <class InputIt1, class InputIt2, class T, class BinaryOp1,
@@ -1359,11 +3803,19 @@ T transform_reduce(InputIt1 first1, InputIt1 last1, InputIt2 first2, T init,
                       std::iterator_traits<InputIt2>::iterator_category>::value,
       "Input iterator required");
 
-  auto val = init;
-  while (first1 != last1) {
-    val = binary_op1(val, binary_op2(*first1++, *first2++));
+  if constexpr (is_random_access_it<InputIt1>::value &&
+                is_random_access_it<InputIt2>::value) {
+    return STL::unrolled_reduce(last1 - first1, init, binary_op1,
+                                [first1, first2, &binary_op2](std::ptrdiff_t i) {
+                                  return binary_op2(first1[i], first2[i]);
+                                });
+  } else {
+    auto val = init;
+    while (first1 != last1) {
+      val = binary_op1(val, binary_op2(*first1++, *first2++));
+    }
+    return val;
   }
-  return val;
 }
 
 template <class InputIt1, class InputIt2, class T>
@@ -1396,11 +3848,11 @@ OutputIt transform_exclusive_scan(InputIt first, InputIt last, OutputIt d_first,
 
   auto val = init;
   while (first != last) {
-    *first = unary_op(*first);
+    auto next = binary_op(val, unary_op(*first++));
     *d_first++ = val;
-    val = binary_op(val, *first++);
+    val = next;
   }
-  return val;
+  return d_first;
 }
 
 template <class InputIt, class OutputIt, class BinaryOperation,
@@ -1415,11 +3867,23 @@ OutputIt transform_inclusive_scan(InputIt first, InputIt last, OutputIt d_first,
 
   auto val = init;
   while (first != last) {
-    *first = unary_op(*first);
-    val = binary_op(val, *first++);
+    val = binary_op(val, unary_op(*first++));
     *d_first++ = val;
   }
-  return val;
+  return d_first;
+}
+
+template <class InputIt, class OutputIt, class BinaryOperation,
+          class UnaryOperation>
+OutputIt transform_inclusive_scan(InputIt first, InputIt last, OutputIt d_first,
+                                  BinaryOperation binary_op,
+                                  UnaryOperation unary_op) {
+  if (first == last)
+    return d_first;
+  auto init = unary_op(*first);
+  *d_first++ = init;
+  return STL::transform_inclusive_scan(++first, last, d_first, binary_op,
+                                       unary_op, init);
 }
 
 template <class InputIt1, class InputIt2, class Compare>
@@ -1435,19 +3899,31 @@ bool lexicographical_compare(InputIt1 first1, InputIt1 last1, InputIt2 first2,
                       std::iterator_traits<InputIt2>::iterator_category>::value,
       "Input iterator required");
 
-  while (first1 != last1) {
-    if (comp(*first1, *first2)) {
-      return true;
-    } else {
-      if (comp(*first2, *first1)) {
+  // The first differing element decides; integers and pointers are found
+  // unequal by their bytes.
+  using value_type1 = typename std::iterator_traits<InputIt1>::value_type;
+  if constexpr (is_bytewise_equal<InputIt1, InputIt2>() &&
+                is_less_compare<value_type1, Compare>::value) {
+    auto n1 = last1 - first1;
+    auto n2 = last2 - first2;
+    auto n = n1 < n2 ? n1 : n2;
+    if (n > 0) {
+      auto i = STL::simd_mismatch(STL::to_pointer(first1),
+                                  STL::to_pointer(first2),
+                                  static_cast<std::size_t>(n));
+      if (i < static_cast<std::size_t>(n))
+        return comp(first1[i], first2[i]);
+    }
+    return n1 < n2;
+  } else {
+    for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+      if (comp(*first1, *first2))
+        return true;
+      if (comp(*first2, *first1))
         return false;
-      } else {
-        ++first1;
-        ++first2;
-      }
     }
+    return first1 == last1 && first2 != last2;
   }
-  return false;
 }
 
 template <class InputIt1, class InputIt2>
@@ -1458,4 +3934,1015 @@ bool lexicographical_compare(InputIt1 first1, InputIt1 last1, InputIt2 first2,
       std::less<typename std::iterator_traits<InputIt1>::value_type>());
 }
 
+// Execution policy overloads. With execution::par or execution::par_unseq and
+// random access iterators the range is split into chunks that are processed
+// on the shared scheduler; otherwise the serial algorithm is called.
+template <class ExecutionPolicy, class... IT>
+inline constexpr bool run_in_parallel_v =
+    execution::is_parallel_policy_v<ExecutionPolicy> &&
+    (is_random_access_it<IT>::value && ...);
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryFunc,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+void for_each(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+              UnaryFunc func) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    STL::parallel_for(last - first, [first, &func](auto begin, auto end) {
+      STL::for_each(first + begin, first + end, func);
+    });
+  } else {
+    STL::for_each(first, last, func);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt, class Size, class UnaryFunc,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt for_each_n(ExecutionPolicy &&policy, ForwardIt first, Size n,
+                     UnaryFunc func) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    STL::for_each(policy, first, first + n, func);
+    return first + n;
+  } else {
+    for (auto i = Size{}; i < n; ++i) {
+      func(*first++);
+    }
+    return first;
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class UnaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 transform(ExecutionPolicy &&, ForwardIt1 first, ForwardIt1 last,
+                     ForwardIt2 d_first, UnaryOp op) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>) {
+    STL::parallel_for(last - first, [first, d_first, &op](auto begin,
+                                                          auto end) {
+      STL::transform(first + begin, first + end, d_first + begin, op);
+    });
+    return d_first + (last - first);
+  } else {
+    return STL::transform(first, last, d_first, op);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class BinaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 transform(ExecutionPolicy &&, ForwardIt1 first1, ForwardIt1 last1,
+                     ForwardIt2 first2, ForwardIt3 d_first, BinaryOp op) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>) {
+    STL::parallel_for(last1 - first1, [first1, first2, d_first,
+                                       &op](auto begin, auto end) {
+      STL::transform(first1 + begin, first1 + end, first2 + begin,
+                     d_first + begin, op);
+    });
+    return d_first + (last1 - first1);
+  } else {
+    return STL::transform(first1, last1, first2, d_first, op);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+typename std::iterator_traits<ForwardIt>::difference_type
+count_if(ExecutionPolicy &&, ForwardIt first, ForwardIt last, UnaryPred pred) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    std::atomic<typename std::iterator_traits<ForwardIt>::difference_type>
+        total{0};
+    STL::parallel_for(last - first, [first, &pred, &total](auto begin,
+                                                           auto end) {
+      total += STL::count_if(first + begin, first + end, pred);
+    });
+    return total;
+  } else {
+    return STL::count_if(first, last, pred);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+bool all_of(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+            UnaryPred pred) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    std::atomic<bool> failed{false};
+    STL::parallel_for(last - first, [first, &pred, &failed](auto begin,
+                                                            auto end) {
+      if (!failed.load(std::memory_order_relaxed) &&
+          !STL::all_of(first + begin, first + end, pred)) {
+        failed.store(true, std::memory_order_relaxed);
+      }
+    });
+    return !failed;
+  } else {
+    return STL::all_of(first, last, pred);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+void fill(ExecutionPolicy &&, ForwardIt first, ForwardIt last, const T &val) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    STL::parallel_for(last - first, [first, &val](auto begin, auto end) {
+      STL::fill(first + begin, first + end, val);
+    });
+  } else {
+    STL::fill(first, last, val);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt, class Generator,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+void generate(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+              Generator g) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    STL::parallel_for(last - first, [first, &g](auto begin, auto end) {
+      STL::generate(first + begin, first + end, g);
+    });
+  } else {
+    STL::generate(first, last, g);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 copy(ExecutionPolicy &&, ForwardIt1 first, ForwardIt1 last,
+                ForwardIt2 d_first) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>) {
+    STL::parallel_for(last - first, [first, d_first](auto begin, auto end) {
+      STL::copy(first + begin, first + end, d_first + begin);
+    });
+    return d_first + (last - first);
+  } else {
+    return STL::copy(first, last, d_first);
+  }
+}
+
+// pdqsort_loop with the left part of each partition spawned as a task while
+// the right part is processed in place. Partitions are as uneven as the data
+// makes them, which the scheduler balances by stealing.
+template <bool Branchless, class RandomIt, class Compare>
+void parallel_pdqsort_loop(RandomIt first, RandomIt last, Compare comp,
+                           int bad_allowed, bool leftmost = true) {
+  task_group group;
+  while (last - first >= parallel_cutoff) {
+    auto size = last - first;
+    STL::move_pivot_to_first(first, last, comp);
+
+    if (!leftmost && !comp(*(first - 1), *first)) {
+      first = STL::partition_left(first, last, comp);
+      continue;
+    }
+
+    auto part = Branchless ? STL::partition_right_branchless(first, last, comp)
+                           : STL::partition_right(first, last, comp);
+    auto pivot_pos = part.first;
+
+    auto l_size = pivot_pos - first;
+    auto r_size = last - (pivot_pos + 1);
+    if (l_size < size / 8 || r_size < size / 8) {
+      if (--bad_allowed == 0) {
+        STL::heap_sort(first, last, comp);
+        first = last;
+        break;
+      }
+      if (l_size >= pdqsort_insertion_sort_threshold)
+        STL::shuffle_sort_samples(first, pivot_pos);
+      if (r_size >= pdqsort_insertion_sort_threshold)
+        STL::shuffle_sort_samples(pivot_pos + 1, last);
+    }
+
+    group.spawn([first, pivot_pos, comp, bad_allowed, leftmost] {
+      STL::parallel_pdqsort_loop<Branchless>(first, pivot_pos, comp,
+                                             bad_allowed, leftmost);
+    });
+    first = pivot_pos + 1;
+    leftmost = false;
+  }
+  if (last - first > 1)
+    STL::pdqsort_loop<Branchless>(first, last, comp, bad_allowed, leftmost);
+  group.sync();
+}
+
+template <class ExecutionPolicy, class RandomIt, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+void sort(ExecutionPolicy &&, RandomIt first, RandomIt last, Compare comp) {
+  if constexpr (execution::is_parallel_policy_v<ExecutionPolicy>) {
+    if (last - first < parallel_cutoff || scheduler::instance().size() == 0) {
+      STL::sort(first, last, comp);
+      return;
+    }
+
+    auto log2_size = 0;
+    for (auto n = last - first; n > 1; n >>= 1) {
+      ++log2_size;
+    }
+
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    STL::parallel_pdqsort_loop<
+        is_branchless_compare<value_type, Compare>::value>(first, last, comp,
+                                                           log2_size);
+  } else {
+    STL::sort(first, last, comp);
+  }
+}
+
+template <class ExecutionPolicy, class RandomIt,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+void sort(ExecutionPolicy &&policy, RandomIt first, RandomIt last) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::sort(policy, first, last, std::less<value_type>());
+}
+
+// Reduces elem(first), ..., elem(last - 1) by halving the range and spawning
+// the upper half, so the partial results are combined pairwise in a tree.
+template <class T, class BinaryOp, class Elem>
+T parallel_reduce_tree(std::ptrdiff_t first, std::ptrdiff_t last,
+                       std::ptrdiff_t grain, BinaryOp &binary_op, Elem &elem) {
+  if (last - first <= grain) {
+    T init = elem(first);
+    return STL::unrolled_reduce(
+        last - first - 1, init, binary_op,
+        [first, &elem](std::ptrdiff_t i) { return elem(first + 1 + i); });
+  }
+
+  auto middle = first + (last - first) / 2;
+  std::optional<T> right;
+  task_group group;
+  group.spawn([&] {
+    right.emplace(STL::parallel_reduce_tree<T>(middle, last, grain, binary_op,
+                                               elem));
+  });
+  T left = STL::parallel_reduce_tree<T>(first, middle, grain, binary_op, elem);
+  group.sync();
+  return binary_op(left, *right);
+}
+
+template <class T, class BinaryOp, class Elem>
+T parallel_reduce(std::ptrdiff_t n, T init, BinaryOp &binary_op, Elem &&elem) {
+  auto grain = STL::parallel_grain(n);
+  if (grain >= n)
+    return STL::unrolled_reduce(n, init, binary_op, elem);
+  return binary_op(init, STL::parallel_reduce_tree<T>(0, n, grain, binary_op,
+                                                      elem));
+}
+
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryOp,
+          class UnaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+T transform_reduce(ExecutionPolicy &&, ForwardIt first, ForwardIt last, T init,
+                   BinaryOp binop, UnaryOp unary_op) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    return STL::parallel_reduce(
+        last - first, init, binop,
+        [first, &unary_op](std::ptrdiff_t i) { return unary_op(first[i]); });
+  } else {
+    return STL::transform_reduce(first, last, init, binop, unary_op);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T,
+          class BinaryOp1, class BinaryOp2,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+T transform_reduce(ExecutionPolicy &&, ForwardIt1 first1, ForwardIt1 last1,
+                   ForwardIt2 first2, T init, BinaryOp1 binary_op1,
+                   BinaryOp2 binary_op2) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>) {
+    return STL::parallel_reduce(last1 - first1, init, binary_op1,
+                                [first1, first2, &binary_op2](std::ptrdiff_t i) {
+                                  return binary_op2(first1[i], first2[i]);
+                                });
+  } else {
+    return STL::transform_reduce(first1, last1, first2, init, binary_op1,
+                                 binary_op2);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+T transform_reduce(ExecutionPolicy &&policy, ForwardIt1 first1,
+                   ForwardIt1 last1, ForwardIt2 first2, T init) {
+  return STL::transform_reduce(
+      policy, first1, last1, first2, init,
+      std::plus<typename std::iterator_traits<ForwardIt1>::value_type>(),
+      std::multiplies<typename std::iterator_traits<ForwardIt2>::value_type>());
+}
+
+template <class ExecutionPolicy, class ForwardIt, class T, class BinaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+T reduce(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last, T init,
+         BinaryOp binary_op) {
+  return STL::transform_reduce(policy, first, last, init, binary_op,
+                               [](const auto &val) -> const auto & {
+                                 return val;
+                               });
+}
+
+template <class ExecutionPolicy, class ForwardIt, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+T reduce(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last, T init) {
+  return STL::reduce(policy, first, last, init, std::plus<>());
+}
+
+template <class ExecutionPolicy, class ForwardIt,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+auto reduce(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last) {
+  return STL::reduce(
+      policy, first, last,
+      typename std::iterator_traits<ForwardIt>::value_type{});
+}
+
+// Scans with at least this many elements use scan_lookback.
+constexpr std::ptrdiff_t parallel_lookback_cutoff = 1 << 22;
+
+// Elements per tile in scan_lookback, small enough for a tile to stay in
+// cache between its reduction and its scan.
+constexpr std::ptrdiff_t parallel_scan_tile = 1 << 14;
+
+// Writes the scan of elem(first), ..., elem(last - 1) starting from val to
+// d_first[first], ..., d_first[last - 1]. Each element is read before its
+// output is written, so the output may alias the input.
+template <bool Inclusive, class T, class BinaryOp, class Elem, class OutputIt>
+void scan_block(std::ptrdiff_t first, std::ptrdiff_t last, T val,
+                BinaryOp &binary_op, Elem &elem, OutputIt d_first) {
+  for (auto i = first; i < last; ++i) {
+    if constexpr (Inclusive) {
+      val = binary_op(val, elem(i));
+      d_first[i] = val;
+    } else {
+      auto next = binary_op(val, elem(i));
+      d_first[i] = val;
+      val = next;
+    }
+  }
+}
+
+template <class T, class BinaryOp, class Elem>
+T reduce_block(std::ptrdiff_t first, std::ptrdiff_t last, BinaryOp &binary_op,
+               Elem &elem) {
+  T init = elem(first);
+  return STL::unrolled_reduce(
+      last - first - 1, init, binary_op,
+      [first, &elem](std::ptrdiff_t i) { return elem(first + 1 + i); });
+}
+
+// Two-pass blocked scan: every block is reduced in parallel, the block sums
+// are scanned serially into per-block offsets, then every block is scanned
+// in parallel starting from its offset.
+template <bool Inclusive, class T, class BinaryOp, class Elem, class OutputIt>
+void scan_two_pass(std::ptrdiff_t n, std::ptrdiff_t block, T init,
+                   BinaryOp &binary_op, Elem &elem, OutputIt d_first) {
+  auto blocks = (n + block - 1) / block;
+  std::vector<std::optional<T>> sums(blocks);
+  auto reduce_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      auto last = (b + 1) * block < n ? (b + 1) * block : n;
+      sums[b].emplace(STL::reduce_block<T>(b * block, last, binary_op, elem));
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, reduce_blocks);
+
+  std::vector<T> offsets;
+  offsets.reserve(blocks);
+  offsets.push_back(init);
+  for (auto b = std::ptrdiff_t{1}; b < blocks; ++b) {
+    offsets.push_back(binary_op(offsets.back(), *sums[b - 1]));
+  }
+
+  auto scan_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      auto last = (b + 1) * block < n ? (b + 1) * block : n;
+      STL::scan_block<Inclusive>(b * block, last, offsets[b], binary_op, elem,
+                                 d_first);
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, scan_blocks);
+}
+
+// Single-pass scan with decoupled look-back (Merrill and Garland). Tiles are
+// claimed in order from a counter. A tile publishes its own sum, then walks
+// back over its predecessors adding up published sums until it reaches one
+// whose inclusive prefix is known, publishes its own inclusive prefix and
+// scans its elements while they are still in cache. A predecessor that has
+// published nothing yet is always being worked on, so waiting for it is
+// short. The input is read from memory once instead of twice.
+template <bool Inclusive, class T, class BinaryOp, class Elem, class OutputIt>
+void scan_lookback(std::ptrdiff_t n, T init, BinaryOp &binary_op, Elem &elem,
+                   OutputIt d_first) {
+  enum : int { empty, sum_ready, prefix_ready };
+  struct tile_state {
+    std::atomic<int> status{empty};
+    std::optional<T> sum;
+    std::optional<T> prefix;
+  };
+
+  auto tiles = (n + parallel_scan_tile - 1) / parallel_scan_tile;
+  std::unique_ptr<tile_state[]> states(new tile_state[tiles]);
+  std::atomic<std::ptrdiff_t> next{0};
+
+  auto work = [&] {
+    for (auto t = next++; t < tiles; t = next++) {
+      auto first = t * parallel_scan_tile;
+      auto last = first + parallel_scan_tile < n ? first + parallel_scan_tile : n;
+      T sum = STL::reduce_block<T>(first, last, binary_op, elem);
+
+      auto &state = states[t];
+      if (t == 0) {
+        state.prefix.emplace(binary_op(init, sum));
+        state.status.store(prefix_ready, std::memory_order_release);
+        STL::scan_block<Inclusive>(first, last, init, binary_op, elem, d_first);
+        continue;
+      }
+
+      state.sum.emplace(sum);
+      state.status.store(sum_ready, std::memory_order_release);
+
+      std::optional<T> exclusive;
+      for (auto p = t - 1;;) {
+        auto status = states[p].status.load(std::memory_order_acquire);
+        if (status == empty) {
+          std::this_thread::yield();
+          continue;
+        }
+        const T &part =
+            status == prefix_ready ? *states[p].prefix : *states[p].sum;
+        if (exclusive)
+          exclusive.emplace(binary_op(part, *exclusive));
+        else
+          exclusive.emplace(part);
+        if (status == prefix_ready)
+          break;
+        --p;
+      }
+
+      state.prefix.emplace(binary_op(*exclusive, sum));
+      state.status.store(prefix_ready, std::memory_order_release);
+      STL::scan_block<Inclusive>(first, last, *exclusive, binary_op, elem,
+                                 d_first);
+    }
+  };
+
+  task_group group;
+  for (auto i = 0u; i < scheduler::instance().size(); ++i) {
+    group.spawn(work);
+  }
+  work();
+  group.sync();
+}
+
+template <bool Inclusive, class T, class BinaryOp, class Elem, class OutputIt>
+void parallel_scan(std::ptrdiff_t n, T init, BinaryOp &binary_op, Elem &&elem,
+                   OutputIt d_first) {
+  auto grain = STL::parallel_grain(n);
+  if (grain >= n)
+    STL::scan_block<Inclusive>(0, n, init, binary_op, elem, d_first);
+  else if (n >= parallel_lookback_cutoff)
+    STL::scan_lookback<Inclusive>(n, init, binary_op, elem, d_first);
+  else
+    STL::scan_two_pass<Inclusive>(n, grain, init, binary_op, elem, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T,
+          class BinaryOp, class UnaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 transform_exclusive_scan(ExecutionPolicy &&, ForwardIt1 first,
+                                    ForwardIt1 last, ForwardIt2 d_first,
+                                    T init, BinaryOp binary_op,
+                                    UnaryOp unary_op) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>) {
+    STL::parallel_scan<false>(
+        last - first, init, binary_op,
+        [first, &unary_op](std::ptrdiff_t i) { return unary_op(first[i]); },
+        d_first);
+    return d_first + (last - first);
+  } else {
+    return STL::transform_exclusive_scan(first, last, d_first, init,
+                                         binary_op, unary_op);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class BinaryOp, class UnaryOp, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 transform_inclusive_scan(ExecutionPolicy &&, ForwardIt1 first,
+                                    ForwardIt1 last, ForwardIt2 d_first,
+                                    BinaryOp binary_op, UnaryOp unary_op,
+                                    T init) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>) {
+    STL::parallel_scan<true>(
+        last - first, init, binary_op,
+        [first, &unary_op](std::ptrdiff_t i) { return unary_op(first[i]); },
+        d_first);
+    return d_first + (last - first);
+  } else {
+    return STL::transform_inclusive_scan(first, last, d_first, binary_op,
+                                         unary_op, init);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class BinaryOp, class UnaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 transform_inclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                                    ForwardIt1 last, ForwardIt2 d_first,
+                                    BinaryOp binary_op, UnaryOp unary_op) {
+  if (first == last)
+    return d_first;
+  auto init = unary_op(*first);
+  *d_first++ = init;
+  return STL::transform_inclusive_scan(policy, ++first, last, d_first,
+                                       binary_op, unary_op, init);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T,
+          class BinaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 exclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first, T init,
+                          BinaryOp binary_op) {
+  return STL::transform_exclusive_scan(policy, first, last, d_first, init,
+                                       binary_op,
+                                       [](const auto &val) -> const auto & {
+                                         return val;
+                                       });
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 exclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first, T init) {
+  return STL::exclusive_scan(policy, first, last, d_first, init,
+                             std::plus<>());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class BinaryOp, class T,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 inclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first,
+                          BinaryOp binary_op, T init) {
+  return STL::transform_inclusive_scan(policy, first, last, d_first,
+                                       binary_op,
+                                       [](const auto &val) -> const auto & {
+                                         return val;
+                                       },
+                                       init);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class BinaryOp,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 inclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first,
+                          BinaryOp binary_op) {
+  return STL::transform_inclusive_scan(policy, first, last, d_first,
+                                       binary_op,
+                                       [](const auto &val) -> const auto & {
+                                         return val;
+                                       });
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 inclusive_scan(ExecutionPolicy &&policy, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first) {
+  return STL::inclusive_scan(policy, first, last, d_first, std::plus<>());
+}
+
+// Output iterator that discards what is written through it and only counts
+// the assignments.
+class counting_output_iterator {
+public:
+  using iterator_category = std::output_iterator_tag;
+  using value_type = void;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = void;
+
+  counting_output_iterator &operator*() noexcept { return *this; }
+  counting_output_iterator &operator++() noexcept { return *this; }
+  counting_output_iterator &operator++(int) noexcept { return *this; }
+
+  template <class T> counting_output_iterator &operator=(T &&) noexcept {
+    ++count_m;
+    return *this;
+  }
+
+  std::ptrdiff_t count() const noexcept { return count_m; }
+
+private:
+  std::ptrdiff_t count_m = 0;
+};
+
+// Parallel stream compaction. run(first, last, d_first) is a serial
+// algorithm that writes some of the elements of [first, last) to d_first. It
+// is run on every block twice: into a counting_output_iterator to find how
+// many elements the block emits, then, after an exclusive scan of the counts
+// has given every block its output offset, into its slice of the output.
+// The result is in the same order as a single serial run.
+template <class RandomIt, class OutputIt, class Run>
+OutputIt parallel_compact(RandomIt first, RandomIt last, OutputIt d_first,
+                          Run run) {
+  auto n = last - first;
+  auto block = STL::parallel_grain(n);
+  if (block >= n)
+    return run(first, last, d_first);
+
+  auto blocks = (n + block - 1) / block;
+  auto block_end = [n, block](std::ptrdiff_t b) {
+    return (b + 1) * block < n ? (b + 1) * block : n;
+  };
+
+  std::vector<std::ptrdiff_t> counts(blocks);
+  auto count_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      counts[b] = run(first + b * block, first + block_end(b),
+                      counting_output_iterator())
+                      .count();
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, count_blocks);
+
+  std::vector<std::ptrdiff_t> offsets(blocks);
+  STL::exclusive_scan(counts.begin(), counts.end(), offsets.begin(),
+                      std::ptrdiff_t{});
+
+  auto scatter_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      run(first + b * block, first + block_end(b), d_first + offsets[b]);
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, scatter_blocks);
+  return d_first + (offsets.back() + counts.back());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 copy_if(ExecutionPolicy &&, ForwardIt1 first, ForwardIt1 last,
+                   ForwardIt2 d_first, UnaryPred pred) {
+  auto run = [&pred](auto first, auto last, auto d_first) {
+    return STL::copy_if(first, last, d_first, pred);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>)
+    return STL::parallel_compact(first, last, d_first, run);
+  else
+    return run(first, last, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt2 remove_copy_if(ExecutionPolicy &&, ForwardIt1 first,
+                          ForwardIt1 last, ForwardIt2 d_first,
+                          UnaryPred pred) {
+  auto run = [&pred](auto first, auto last, auto d_first) {
+    return STL::remove_copy_if(first, last, d_first, pred);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2>)
+    return STL::parallel_compact(first, last, d_first, run);
+  else
+    return run(first, last, d_first);
+}
+
+// Moves the elements passing keep and then, if keep_rejected is set, those
+// failing it into a buffer and back, which also makes the result stable.
+// Blocks count their kept elements, an exclusive scan of the counts gives
+// every block its offsets in both groups, and the blocks move-construct their
+// elements into the raw buffer in parallel; moving them back destroys them
+// in parallel too. Returns the end of the kept elements, and false if the
+// buffer could not be allocated and nothing was done.
+template <class RandomIt, class UnaryPred>
+std::pair<RandomIt, bool>
+parallel_partition_through_buffer(RandomIt first, RandomIt last,
+                                  UnaryPred &keep, bool keep_rejected) {
+  auto n = last - first;
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+  STL::uninitialized_buffer<value_type> buffer(n);
+  if (!buffer.data())
+    return {first, false};
+
+  auto block = STL::parallel_grain(n);
+  auto blocks = (n + block - 1) / block;
+  auto block_end = [n, block](std::ptrdiff_t b) {
+    return (b + 1) * block < n ? (b + 1) * block : n;
+  };
+
+  std::vector<std::ptrdiff_t> counts(blocks);
+  auto count_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      counts[b] = STL::count_if(first + b * block, first + block_end(b), keep);
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, count_blocks);
+
+  std::vector<std::ptrdiff_t> offsets(blocks);
+  STL::exclusive_scan(counts.begin(), counts.end(), offsets.begin(),
+                      std::ptrdiff_t{});
+  auto kept = offsets.back() + counts.back();
+
+  auto data = buffer.data();
+  auto scatter_blocks = [&](std::ptrdiff_t b_first, std::ptrdiff_t b_last) {
+    for (auto b = b_first; b < b_last; ++b) {
+      auto out_kept = data + offsets[b];
+      auto out_rejected = data + kept + (b * block - offsets[b]);
+      for (auto it = first + b * block; it != first + block_end(b); ++it) {
+        if (keep(*it))
+          ::new (static_cast<void *>(out_kept++)) value_type(std::move(*it));
+        else if (keep_rejected)
+          ::new (static_cast<void *>(out_rejected++))
+              value_type(std::move(*it));
+      }
+    }
+  };
+  STL::parallel_for_split(0, blocks, 1, scatter_blocks);
+
+  STL::parallel_for(keep_rejected ? n : kept, [&](auto b_first, auto b_last) {
+    STL::move(data + b_first, data + b_last, first + b_first);
+    if constexpr (!std::is_trivially_destructible<value_type>::value) {
+      for (auto it = data + b_first; it != data + b_last; ++it) {
+        it->~value_type();
+      }
+    }
+  });
+  return {first + kept, true};
+}
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt remove_if(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+                    UnaryPred pred) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    if (STL::parallel_grain(last - first) < last - first) {
+      auto keep = [&pred](const auto &val) { return !pred(val); };
+      auto result =
+          STL::parallel_partition_through_buffer(first, last, keep, false);
+      if (result.second)
+        return result.first;
+    }
+  }
+  return STL::remove_if(first, last, pred);
+}
+
+template <class ExecutionPolicy, class ForwardIt, class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt stable_partition(ExecutionPolicy &&, ForwardIt first, ForwardIt last,
+                           UnaryPred pred) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>) {
+    if (STL::parallel_grain(last - first) < last - first) {
+      auto result =
+          STL::parallel_partition_through_buffer(first, last, pred, true);
+      if (result.second)
+        return result.first;
+    }
+  }
+  return STL::stable_partition(first, last, pred);
+}
+
+// The parallel version is stable, so the order within the two groups can
+// differ from the serial partition, which swaps elements into place.
+template <class ExecutionPolicy, class ForwardIt, class UnaryPred,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt partition(ExecutionPolicy &&policy, ForwardIt first, ForwardIt last,
+                    UnaryPred pred) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt>)
+    return STL::stable_partition(policy, first, last, pred);
+  else
+    return STL::partition(first, last, pred);
+}
+
+// Merge path co-ranking: returns how many of the first k elements written by
+// merge(first1, first1 + n1, first2, first2 + n2, ...) come from the first
+// range. merge takes the element of the second range on ties, so a[i - 1] is
+// written before b[k - i] only if it compares less.
+template <class RandomIt1, class RandomIt2, class Compare>
+std::ptrdiff_t merge_path_split(RandomIt1 first1, std::ptrdiff_t n1,
+                                RandomIt2 first2, std::ptrdiff_t n2,
+                                std::ptrdiff_t k, Compare &comp) {
+  auto lo = k > n2 ? k - n2 : std::ptrdiff_t{};
+  auto hi = k < n1 ? k : n1;
+  while (lo < hi) {
+    auto i = lo + (hi - lo + 1) / 2;
+    if (comp(first1[i - 1], first2[k - i]))
+      lo = i;
+    else
+      hi = i - 1;
+  }
+  return lo;
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 merge(ExecutionPolicy &&, ForwardIt1 first1, ForwardIt1 last1,
+                 ForwardIt2 first2, ForwardIt2 last2, ForwardIt3 d_first,
+                 Compare comp) {
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>) {
+    auto n1 = last1 - first1;
+    auto n2 = last2 - first2;
+    STL::parallel_for(n1 + n2, [&](std::ptrdiff_t k_first,
+                                   std::ptrdiff_t k_last) {
+      auto i_first = STL::merge_path_split(first1, n1, first2, n2, k_first,
+                                           comp);
+      auto i_last = STL::merge_path_split(first1, n1, first2, n2, k_last,
+                                          comp);
+      STL::merge(first1 + i_first, first1 + i_last,
+                 first2 + (k_first - i_first), first2 + (k_last - i_last),
+                 d_first + k_first, comp);
+    });
+    return d_first + (n1 + n2);
+  } else {
+    return STL::merge(first1, last1, first2, last2, d_first, comp);
+  }
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 merge(ExecutionPolicy &&policy, ForwardIt1 first1,
+                 ForwardIt1 last1, ForwardIt2 first2, ForwardIt2 last2,
+                 ForwardIt3 d_first) {
+  return STL::merge(policy, first1, last1, first2, last2, d_first,
+                    std::less<>());
+}
+
+// Runs the serial set operation run(first1, last1, first2, last2, d_first) on
+// independent segments of the two ranges. Segment boundaries start at evenly
+// spaced merge path diagonals and are moved back to the lower bound of the
+// element there in both ranges, so no run of equivalent elements is split
+// and every segment produces exactly what the serial operation would. The
+// output is then placed like in parallel_compact: every segment is run once
+// to count, once more to write at its offset.
+template <class RandomIt1, class RandomIt2, class OutputIt, class Compare,
+          class Run>
+OutputIt parallel_set_operation(RandomIt1 first1, RandomIt1 last1,
+                                RandomIt2 first2, RandomIt2 last2,
+                                OutputIt d_first, Compare &comp, Run run) {
+  auto n1 = last1 - first1;
+  auto n2 = last2 - first2;
+  auto block = STL::parallel_grain(n1 + n2);
+  if (block >= n1 + n2)
+    return run(first1, last1, first2, last2, d_first);
+
+  auto segments = (n1 + n2 + block - 1) / block;
+  std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>> splits;
+  splits.reserve(segments + 1);
+  splits.emplace_back(0, 0);
+  for (auto s = std::ptrdiff_t{1}; s < segments; ++s) {
+    auto k = s * block;
+    auto i = STL::merge_path_split(first1, n1, first2, n2, k, comp);
+    auto j = k - i;
+    const auto &pivot =
+        j < n2 && (i == n1 || !comp(first1[i], first2[j])) ? first2[j]
+                                                           : first1[i];
+    splits.emplace_back(STL::lower_bound(first1, last1, pivot, comp) - first1,
+                        STL::lower_bound(first2, last2, pivot, comp) - first2);
+  }
+  splits.emplace_back(n1, n2);
+
+  auto run_segment = [&](std::ptrdiff_t s, auto d_first) {
+    return run(first1 + splits[s].first, first1 + splits[s + 1].first,
+               first2 + splits[s].second, first2 + splits[s + 1].second,
+               d_first);
+  };
+
+  std::vector<std::ptrdiff_t> counts(segments);
+  auto count_segments = [&](std::ptrdiff_t s_first, std::ptrdiff_t s_last) {
+    for (auto s = s_first; s < s_last; ++s) {
+      counts[s] = run_segment(s, counting_output_iterator()).count();
+    }
+  };
+  STL::parallel_for_split(0, segments, 1, count_segments);
+
+  std::vector<std::ptrdiff_t> offsets(segments);
+  STL::exclusive_scan(counts.begin(), counts.end(), offsets.begin(),
+                      std::ptrdiff_t{});
+
+  auto write_segments = [&](std::ptrdiff_t s_first, std::ptrdiff_t s_last) {
+    for (auto s = s_first; s < s_last; ++s) {
+      run_segment(s, d_first + offsets[s]);
+    }
+  };
+  STL::parallel_for_split(0, segments, 1, write_segments);
+  return d_first + (offsets.back() + counts.back());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_union(ExecutionPolicy &&, ForwardIt1 first1, ForwardIt1 last1,
+                     ForwardIt2 first2, ForwardIt2 last2, ForwardIt3 d_first,
+                     Compare comp) {
+  auto run = [&comp](auto first1, auto last1, auto first2, auto last2,
+                     auto d_first) {
+    return STL::set_union(first1, last1, first2, last2, d_first, comp);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>)
+    return STL::parallel_set_operation(first1, last1, first2, last2, d_first,
+                                       comp, run);
+  else
+    return run(first1, last1, first2, last2, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_union(ExecutionPolicy &&policy, ForwardIt1 first1,
+                     ForwardIt1 last1, ForwardIt2 first2, ForwardIt2 last2,
+                     ForwardIt3 d_first) {
+  return STL::set_union(policy, first1, last1, first2, last2, d_first,
+                        std::less<>());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_intersection(ExecutionPolicy &&, ForwardIt1 first1,
+                            ForwardIt1 last1, ForwardIt2 first2,
+                            ForwardIt2 last2, ForwardIt3 d_first,
+                            Compare comp) {
+  auto run = [&comp](auto first1, auto last1, auto first2, auto last2,
+                     auto d_first) {
+    return STL::set_intersection(first1, last1, first2, last2, d_first, comp);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>)
+    return STL::parallel_set_operation(first1, last1, first2, last2, d_first,
+                                       comp, run);
+  else
+    return run(first1, last1, first2, last2, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_intersection(ExecutionPolicy &&policy, ForwardIt1 first1,
+                            ForwardIt1 last1, ForwardIt2 first2,
+                            ForwardIt2 last2, ForwardIt3 d_first) {
+  return STL::set_intersection(policy, first1, last1, first2, last2, d_first,
+                               std::less<>());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_difference(ExecutionPolicy &&, ForwardIt1 first1,
+                          ForwardIt1 last1, ForwardIt2 first2,
+                          ForwardIt2 last2, ForwardIt3 d_first, Compare comp) {
+  auto run = [&comp](auto first1, auto last1, auto first2, auto last2,
+                     auto d_first) {
+    return STL::set_difference(first1, last1, first2, last2, d_first, comp);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>)
+    return STL::parallel_set_operation(first1, last1, first2, last2, d_first,
+                                       comp, run);
+  else
+    return run(first1, last1, first2, last2, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_difference(ExecutionPolicy &&policy, ForwardIt1 first1,
+                          ForwardIt1 last1, ForwardIt2 first2,
+                          ForwardIt2 last2, ForwardIt3 d_first) {
+  return STL::set_difference(policy, first1, last1, first2, last2, d_first,
+                             std::less<>());
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3, class Compare,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_symmetric_difference(ExecutionPolicy &&, ForwardIt1 first1,
+                                    ForwardIt1 last1, ForwardIt2 first2,
+                                    ForwardIt2 last2, ForwardIt3 d_first,
+                                    Compare comp) {
+  auto run = [&comp](auto first1, auto last1, auto first2, auto last2,
+                     auto d_first) {
+    return STL::set_symmetric_difference(first1, last1, first2, last2,
+                                         d_first, comp);
+  };
+  if constexpr (run_in_parallel_v<ExecutionPolicy, ForwardIt1, ForwardIt2,
+                                  ForwardIt3>)
+    return STL::parallel_set_operation(first1, last1, first2, last2, d_first,
+                                       comp, run);
+  else
+    return run(first1, last1, first2, last2, d_first);
+}
+
+template <class ExecutionPolicy, class ForwardIt1, class ForwardIt2,
+          class ForwardIt3,
+          typename = execution::enable_if_execution_policy<ExecutionPolicy>>
+ForwardIt3 set_symmetric_difference(ExecutionPolicy &&policy,
+                                    ForwardIt1 first1, ForwardIt1 last1,
+                                    ForwardIt2 first2, ForwardIt2 last2,
+                                    ForwardIt3 d_first) {
+  return STL::set_symmetric_difference(policy, first1, last1, first2, last2,
+                                       d_first, std::less<>());
+}
+
 } // namespace STL
\ No newline at end of file
@@ -21,6 +21,8 @@ public:
     using reference = typename REFERENCE;
     using pointer = POINTER;
     using iterator_category = std::random_access_iterator_tag;
+    // Wraps a pointer into the array, so algorithms may work on it directly.
+    static constexpr bool is_contiguous = true;
 
     constexpr reference operator*() const noexcept { return *_ptr; }
     constexpr pointer operator->() const noexcept { return _ptr; }
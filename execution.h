@@ -0,0 +1,523 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+namespace STL {
+namespace execution {
+class sequenced_policy {};
+class parallel_policy {};
+class parallel_unsequenced_policy {};
+
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy par{};
+inline constexpr parallel_unsequenced_policy par_unseq{};
+
+template <typename T> struct is_execution_policy : std::false_type {};
+template <> struct is_execution_policy<sequenced_policy> : std::true_type {};
+template <> struct is_execution_policy<parallel_policy> : std::true_type {};
+template <>
+struct is_execution_policy<parallel_unsequenced_policy> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_execution_policy_v =
+    is_execution_policy<std::decay_t<T>>::value;
+
+template <typename T>
+inline constexpr bool is_parallel_policy_v =
+    std::is_same_v<std::decay_t<T>, parallel_policy> ||
+    std::is_same_v<std::decay_t<T>, parallel_unsequenced_policy>;
+
+template <typename T>
+using enable_if_execution_policy = std::enable_if_t<is_execution_policy_v<T>>;
+} // namespace execution
+
+// Chase-Lev work-stealing deque (Chase and Lev 2005, with the memory orderings
+// of Le et al. 2013). The owning thread pushes and pops at the bottom, other
+// threads steal from the top. Rings replaced when the deque grows are kept
+// until destruction because a thief may still be reading from them.
+template <class T> class work_stealing_deque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Deque elements are copied without synchronisation");
+
+  struct ring {
+    explicit ring(std::ptrdiff_t capacity)
+        : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+
+    T get(std::ptrdiff_t i) const noexcept {
+      return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(std::ptrdiff_t i, T item) noexcept {
+      items[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+    }
+
+    std::ptrdiff_t capacity;
+    std::unique_ptr<std::atomic<T>[]> items;
+  };
+
+public:
+  explicit work_stealing_deque(std::ptrdiff_t capacity = 256) {
+    rings_m.emplace_back(new ring(capacity));
+    ring_m.store(rings_m.back().get(), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+  // Owner only.
+  void push(T item) {
+    auto b = bottom_m.load(std::memory_order_relaxed);
+    auto t = top_m.load(std::memory_order_acquire);
+    auto r = ring_m.load(std::memory_order_relaxed);
+    if (b - t > r->capacity - 1) {
+      auto bigger = new ring(r->capacity * 2);
+      for (auto i = t; i < b; ++i) {
+        bigger->put(i, r->get(i));
+      }
+      rings_m.emplace_back(bigger);
+      r = bigger;
+      ring_m.store(r, std::memory_order_release);
+    }
+    r->put(b, item);
+    bottom_m.store(b + 1, std::memory_order_release);
+  }
+
+  // Owner only. Returns T{} if the deque is empty.
+  T pop() noexcept {
+    auto b = bottom_m.load(std::memory_order_relaxed) - 1;
+    auto r = ring_m.load(std::memory_order_relaxed);
+    bottom_m.store(b, std::memory_order_seq_cst);
+    auto t = top_m.load(std::memory_order_seq_cst);
+    if (t > b) {
+      bottom_m.store(b + 1, std::memory_order_relaxed);
+      return T{};
+    }
+    auto item = r->get(b);
+    if (t == b) {
+      // Last element: race the thieves for it.
+      if (!top_m.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+        item = T{};
+      bottom_m.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Any thread. Returns T{} if the deque is empty or the steal lost a race.
+  T steal() noexcept {
+    auto t = top_m.load(std::memory_order_seq_cst);
+    auto b = bottom_m.load(std::memory_order_seq_cst);
+    if (t >= b)
+      return T{};
+    auto item = ring_m.load(std::memory_order_acquire)->get(t);
+    if (!top_m.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+      return T{};
+    return item;
+  }
+
+  bool empty() const noexcept {
+    return bottom_m.load(std::memory_order_relaxed) <=
+           top_m.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::ptrdiff_t> top_m{0};
+  std::atomic<std::ptrdiff_t> bottom_m{0};
+  std::atomic<ring *> ring_m{nullptr};
+  std::vector<std::unique_ptr<ring>> rings_m;
+};
+
+class task_group;
+
+struct task {
+  explicit task(task_group *group) noexcept : group(group) {}
+  virtual ~task() = default;
+  virtual void run() = 0;
+
+  task_group *group;
+};
+
+template <class Func> struct function_task : task {
+  template <class F>
+  function_task(F &&func, task_group *group)
+      : task(group), func(std::forward<F>(func)) {}
+
+  void run() override { func(); }
+
+  Func func;
+};
+
+// The cpus the process may run on, in increasing order; empty where the
+// system does not tell.
+inline std::vector<unsigned> allowed_cpus() {
+  std::vector<unsigned> cpus;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (auto cpu = 0u; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set))
+        cpus.push_back(cpu);
+    }
+  }
+#elif defined(_WIN32)
+  DWORD_PTR process = 0, system = 0;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) {
+    for (auto cpu = 0u; cpu < sizeof(DWORD_PTR) * 8; ++cpu) {
+      if (process & (DWORD_PTR{1} << cpu))
+        cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+// Binds the thread to the given cpu. Returns false if the system refused or
+// does not support it.
+inline bool pin_thread(std::thread &thread, unsigned cpu) {
+#if defined(__linux__)
+  if (cpu >= CPU_SETSIZE)
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) ==
+         0;
+#elif defined(_WIN32)
+  if (cpu >= sizeof(DWORD_PTR) * 8)
+    return false;
+  return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{1} << cpu) !=
+         0;
+#else
+  (void)thread;
+  (void)cpu;
+  return false;
+#endif
+}
+
+// Fork-join scheduler behind the parallel algorithms. Every worker owns a
+// work_stealing_deque: tasks spawned on a worker go to the bottom of its own
+// deque and are popped LIFO, idle workers steal the oldest task of a random
+// victim. Tasks spawned from other threads go through a shared queue.
+class scheduler {
+public:
+  // With pin_workers every worker gets a cpu of its own from the cpus the
+  // process may use, past the first one, which the thread calling into the
+  // algorithms keeps. If there are not enough of them no worker is pinned.
+  explicit scheduler(unsigned workers, bool pin_workers = false) {
+    workers_m.reserve(workers);
+    for (auto i = 0u; i < workers; ++i) {
+      workers_m.emplace_back(new worker(this, i));
+    }
+    auto cpus = pin_workers ? STL::allowed_cpus() : std::vector<unsigned>();
+    pinned_m = pin_workers && cpus.size() > workers;
+    for (auto i = 0u; i < workers; ++i) {
+      auto &w = *workers_m[i];
+      w.thread = std::thread([this, &w] { worker_loop(w); });
+      if (pinned_m && !STL::pin_thread(w.thread, cpus[i + 1]))
+        pinned_m = false;
+    }
+  }
+
+  scheduler(const scheduler &) = delete;
+  scheduler &operator=(const scheduler &) = delete;
+
+  ~scheduler() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      stop_m = true;
+    }
+    wake_m.notify_all();
+    for (auto &w : workers_m) {
+      w->thread.join();
+    }
+  }
+
+  unsigned size() const noexcept {
+    return static_cast<unsigned>(workers_m.size());
+  }
+
+  // Whether pinning was asked for and every worker could be pinned.
+  bool pinned() const noexcept { return pinned_m; }
+
+  // Sets up the scheduler returned by instance(). Only has an effect before
+  // the first parallel algorithm runs; returns false afterwards.
+  static bool configure(unsigned workers, bool pin_workers = false) {
+    auto &opts = options();
+    std::lock_guard<std::mutex> lock(opts.mutex);
+    if (opts.created)
+      return false;
+    opts.workers = workers;
+    opts.pin_workers = pin_workers;
+    return true;
+  }
+
+  // The scheduler shared by all parallel algorithms. By default the calling
+  // thread takes part in the work, so one hardware thread is left for it.
+  static scheduler &instance() {
+    static scheduler &shared = [] () -> scheduler & {
+      auto &opts = options();
+      std::lock_guard<std::mutex> lock(opts.mutex);
+      opts.created = true;
+      static scheduler s(opts.workers, opts.pin_workers);
+      return s;
+    }();
+    return shared;
+  }
+
+  void submit(task *t) {
+    if (auto w = current_worker(); w && w->owner == this) {
+      w->deque.push(t);
+    } else {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      injected_m.push_back(t);
+      ++injected_count_m;
+    }
+    // Pairs with the fence in worker_loop: either the task is seen by a
+    // worker about to sleep, or that worker is seen here. A worker holds
+    // mutex_m from its last look at the queues until it waits, so notifying
+    // under the lock cannot fall in between.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_m.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      wake_m.notify_one();
+    }
+  }
+
+  // Runs one pending task, if any can be found. Used by threads waiting on a
+  // task_group so that they help instead of blocking.
+  bool run_one() {
+    auto w = current_worker();
+    if (auto t = find_task(w && w->owner == this ? w : nullptr)) {
+      execute(t);
+      return true;
+    }
+    return false;
+  }
+
+private:
+  struct worker {
+    worker(scheduler *owner, unsigned index)
+        : owner(owner), index(index), deque(256) {}
+
+    scheduler *owner;
+    unsigned index;
+    work_stealing_deque<task *> deque;
+    std::thread thread;
+  };
+
+  struct scheduler_options {
+    std::mutex mutex;
+    unsigned workers = std::thread::hardware_concurrency() > 1
+                           ? std::thread::hardware_concurrency() - 1
+                           : 0;
+    bool pin_workers = false;
+    bool created = false;
+  };
+
+  static scheduler_options &options() {
+    static scheduler_options opts;
+    return opts;
+  }
+
+  static worker *&current_worker() noexcept {
+    thread_local worker *w = nullptr;
+    return w;
+  }
+
+  task *find_task(worker *self) {
+    if (self) {
+      if (auto t = self->deque.pop())
+        return t;
+    }
+
+    if (injected_count_m.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      if (!injected_m.empty()) {
+        auto t = injected_m.front();
+        injected_m.pop_front();
+        --injected_count_m;
+        return t;
+      }
+    }
+
+    auto n = workers_m.size();
+    if (n == 0)
+      return nullptr;
+    thread_local auto seed = static_cast<unsigned>(
+        std::hash<std::thread::id>()(std::this_thread::get_id()) | 1);
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    for (auto i = 0u, start = static_cast<unsigned>(seed % n); i < n; ++i) {
+      auto &victim = *workers_m[(start + i) % n];
+      if (&victim == self)
+        continue;
+      if (auto t = victim.deque.steal())
+        return t;
+    }
+    return nullptr;
+  }
+
+  inline void execute(task *t) noexcept;
+
+  void worker_loop(worker &self) {
+    current_worker() = &self;
+    auto idle = 0;
+    while (true) {
+      if (auto t = find_task(&self)) {
+        execute(t);
+        idle = 0;
+        continue;
+      }
+      if (++idle < 64) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_m);
+      if (stop_m)
+        return;
+      ++sleeping_m;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!has_pending_task())
+        wake_m.wait(lock);
+      --sleeping_m;
+      idle = 0;
+    }
+  }
+
+  // Whether any queue holds a task. Called with mutex_m held.
+  bool has_pending_task() const noexcept {
+    if (!injected_m.empty())
+      return true;
+    for (auto &w : workers_m) {
+      if (!w->deque.empty())
+        return true;
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<worker>> workers_m;
+  std::deque<task *> injected_m;
+  std::mutex mutex_m;
+  std::condition_variable wake_m;
+  std::atomic<std::ptrdiff_t> injected_count_m{0};
+  std::atomic<int> sleeping_m{0};
+  bool stop_m = false;
+  bool pinned_m = true;
+};
+
+// A set of tasks spawned on a scheduler. sync() returns once all of them have
+// finished; the waiting thread runs pending tasks meanwhile, so nested
+// parallel calls cannot deadlock. As with the standard parallel algorithms,
+// an exception escaping a task terminates the program.
+class task_group {
+public:
+  explicit task_group(scheduler &s = scheduler::instance()) noexcept
+      : scheduler_m(s) {}
+
+  task_group(const task_group &) = delete;
+  task_group &operator=(const task_group &) = delete;
+
+  ~task_group() { sync(); }
+
+  template <class Func> void spawn(Func &&func) {
+    pending_m.fetch_add(1, std::memory_order_relaxed);
+    scheduler_m.submit(
+        new function_task<std::decay_t<Func>>(std::forward<Func>(func), this));
+  }
+
+  void sync() {
+    while (pending_m.load(std::memory_order_acquire) > 0) {
+      if (!scheduler_m.run_one())
+        std::this_thread::yield();
+    }
+  }
+
+private:
+  friend class scheduler;
+
+  void finish() noexcept { pending_m.fetch_sub(1, std::memory_order_release); }
+
+  scheduler &scheduler_m;
+  std::atomic<std::ptrdiff_t> pending_m{0};
+};
+
+inline void scheduler::execute(task *t) noexcept {
+  auto group = t->group;
+  t->run();
+  delete t;
+  group->finish();
+}
+
+// Ranges below this many elements are processed on the calling thread.
+constexpr std::ptrdiff_t parallel_cutoff = 1 << 14;
+
+// Smallest number of elements handed to a single task.
+constexpr std::ptrdiff_t parallel_min_chunk = 1 << 12;
+
+// Number of elements below which a range of n elements is not split any
+// further: about eight pieces per thread, but no fewer than
+// parallel_min_chunk elements each. Returns n if the range should not be
+// processed in parallel at all.
+inline std::ptrdiff_t parallel_grain(std::ptrdiff_t n) {
+  auto workers = static_cast<std::ptrdiff_t>(scheduler::instance().size());
+  if (n < parallel_cutoff || workers == 0)
+    return n;
+  auto grain = n / ((workers + 1) * 8);
+  return grain < parallel_min_chunk ? parallel_min_chunk : grain;
+}
+
+template <class Func>
+void parallel_for_split(std::ptrdiff_t first, std::ptrdiff_t last,
+                        std::ptrdiff_t grain, Func &func) {
+  task_group group;
+  while (last - first > grain) {
+    auto middle = first + (last - first) / 2;
+    group.spawn([middle, last, grain, &func] {
+      STL::parallel_for_split(middle, last, grain, func);
+    });
+    last = middle;
+  }
+  func(first, last);
+  group.sync();
+}
+
+// Calls func(chunk_first, chunk_last) for chunks covering [0, n) on the shared
+// scheduler. The range is halved recursively and the upper halves are
+// spawned, so idle workers steal large pieces first and uneven chunk costs
+// balance out.
+template <class Func> void parallel_for(std::ptrdiff_t n, Func &&func) {
+  auto grain = STL::parallel_grain(n);
+  if (grain >= n) {
+    if (n > 0)
+      func(std::ptrdiff_t{}, n);
+    return;
+  }
+  STL::parallel_for_split(0, n, grain, func);
+}
+} // namespace STL
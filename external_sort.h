@@ -0,0 +1,518 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "algorithm.h"
+
+namespace STL {
+// Tuning of external_sort. The memory budget bounds the records held at once:
+// the run being sorted in the first phase and the read and write buffers of
+// the merge in the second one.
+struct external_sort_options {
+  std::size_t memory_budget = std::size_t{64} << 20;
+  // Where the sorted runs are spilled; the system temporary directory if
+  // empty.
+  std::filesystem::path temp_directory;
+  // Smallest block read or written at once while merging. Every open run is
+  // double buffered, so a merge pass opens at most as many runs as the budget
+  // holds pairs of blocks of this size.
+  std::size_t min_block_size = std::size_t{64} << 10;
+};
+
+// A file in the temporary directory that is removed with the object. The
+// name carries the process id and the file is created right away, so sorts
+// in other processes sharing the directory never pick the same one.
+class temporary_file {
+public:
+  explicit temporary_file(const std::filesystem::path &directory) {
+    static std::atomic<unsigned long long> counter{};
+    auto dir = directory.empty() ? std::filesystem::temp_directory_path()
+                                 : directory;
+#if defined(_WIN32)
+    auto pid = static_cast<unsigned long long>(_getpid());
+#else
+    auto pid = static_cast<unsigned long long>(getpid());
+#endif
+    do {
+      auto stamp = static_cast<unsigned long long>(
+          std::chrono::steady_clock::now().time_since_epoch().count());
+      path_m = dir / ("stl_run_" + std::to_string(pid) + "_" +
+                      std::to_string(stamp) + "_" +
+                      std::to_string(counter++) + ".bin");
+    } while (std::filesystem::exists(path_m));
+    std::ofstream create(path_m, std::ios::binary);
+    if (!create)
+      throw std::runtime_error("Cannot create " + path_m.string() + ".");
+  }
+  temporary_file(temporary_file &&other) noexcept
+      : path_m(std::move(other.path_m)) {
+    other.path_m.clear();
+  }
+  temporary_file &operator=(temporary_file &&other) noexcept {
+    if (this != &other) {
+      remove();
+      path_m = std::move(other.path_m);
+      other.path_m.clear();
+    }
+    return *this;
+  }
+  ~temporary_file() { remove(); }
+
+  const std::filesystem::path &path() const noexcept { return path_m; }
+
+private:
+  void remove() noexcept {
+    if (!path_m.empty()) {
+      std::error_code ec;
+      std::filesystem::remove(path_m, ec);
+    }
+  }
+
+  std::filesystem::path path_m;
+};
+
+// A thread that runs the block reads and writes of the record readers and
+// writers sharing it, one after the other in the order they were submitted.
+// It lives as long as the object, so a merge pass starts one thread however
+// many blocks it moves.
+class io_thread {
+public:
+  io_thread() : thread_m([this] { run(); }) {}
+  io_thread(const io_thread &) = delete;
+  io_thread &operator=(const io_thread &) = delete;
+
+  // Finishes the jobs already submitted first.
+  ~io_thread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      stop_m = true;
+    }
+    wake_m.notify_one();
+    thread_m.join();
+  }
+
+  // Queues job; the future returns its result or rethrows its exception.
+  template <class Job> auto submit(Job &&job) {
+    using result_type = decltype(job());
+    auto task = std::make_shared<std::packaged_task<result_type()>>(
+        std::forward<Job>(job));
+    auto result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_m);
+      jobs_m.emplace_back([task] { (*task)(); });
+    }
+    wake_m.notify_one();
+    return result;
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_m);
+    while (true) {
+      wake_m.wait(lock, [this] { return stop_m || !jobs_m.empty(); });
+      if (jobs_m.empty())
+        return;
+      auto job = std::move(jobs_m.front());
+      jobs_m.pop_front();
+      lock.unlock();
+      job();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_m;
+  std::condition_variable wake_m;
+  std::deque<std::function<void()>> jobs_m;
+  bool stop_m = false;
+  std::thread thread_m;
+};
+
+// Reads a file of fixed-width binary records through two buffers of half of
+// buffer_records each: while the records of one are consumed, the next block
+// is read into the other one on the io_thread. begin()/end() give single-pass
+// input iterators over the records.
+template <class T> class record_reader {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "records are stored as their object representation");
+
+public:
+  record_reader(const std::filesystem::path &path, std::size_t buffer_records,
+                io_thread &io)
+      : io_m(io), file_m(path, std::ios::binary),
+        buffer_m(buffer_records > 1 ? buffer_records / 2 : 1),
+        next_m(buffer_m.size()) {
+    if (!file_m)
+      throw std::runtime_error("Cannot open " + path.string() +
+                               " for reading.");
+    size_m = read_block(buffer_m);
+    read_ahead();
+  }
+  // The read ahead refers to the buffers of this object.
+  record_reader(const record_reader &) = delete;
+  record_reader &operator=(const record_reader &) = delete;
+  ~record_reader() {
+    if (pending_m.valid())
+      pending_m.wait();
+  }
+
+  bool empty() const noexcept { return pos_m == size_m; }
+  const T &front() const noexcept { return buffer_m[pos_m]; }
+  void pop() {
+    if (++pos_m == size_m)
+      next_block();
+  }
+
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    iterator() = default;
+    explicit iterator(record_reader *reader) : reader_m(reader) {}
+
+    reference operator*() const { return reader_m->front(); }
+    pointer operator->() const { return &reader_m->front(); }
+    iterator &operator++() {
+      reader_m->pop();
+      return *this;
+    }
+    // Keeps the current record, which the reader may overwrite when it
+    // refills its buffer.
+    class postfix_proxy {
+    public:
+      explicit postfix_proxy(const T &record) : record_m(record) {}
+      const T &operator*() const { return record_m; }
+
+    private:
+      T record_m;
+    };
+    postfix_proxy operator++(int) {
+      postfix_proxy proxy(**this);
+      ++*this;
+      return proxy;
+    }
+
+    // All iterators over an exhausted reader equal the end iterator.
+    friend bool operator==(const iterator &a, const iterator &b) {
+      return a.at_end() == b.at_end();
+    }
+    friend bool operator!=(const iterator &a, const iterator &b) {
+      return !(a == b);
+    }
+
+  private:
+    bool at_end() const { return !reader_m || reader_m->empty(); }
+
+    record_reader *reader_m = nullptr;
+  };
+
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+private:
+  std::size_t read_block(std::vector<T> &buffer) {
+    file_m.read(reinterpret_cast<char *>(buffer.data()),
+                static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+    if (file_m.bad())
+      throw std::runtime_error("Error while reading a record file.");
+    auto bytes = static_cast<std::size_t>(file_m.gcount());
+    if (bytes % sizeof(T) != 0)
+      throw std::runtime_error("Record file ends with a partial record.");
+    return bytes / sizeof(T);
+  }
+
+  // Starts reading the next block, unless the last one ended the file.
+  void read_ahead() {
+    if (size_m == buffer_m.size())
+      pending_m = io_m.submit([this] { return read_block(next_m); });
+  }
+
+  void next_block() {
+    pos_m = 0;
+    size_m = 0;
+    if (!pending_m.valid())
+      return;
+    size_m = pending_m.get();
+    buffer_m.swap(next_m);
+    read_ahead();
+  }
+
+  io_thread &io_m;
+  std::ifstream file_m;
+  std::vector<T> buffer_m;
+  std::vector<T> next_m;
+  std::size_t pos_m = 0;
+  std::size_t size_m = 0;
+  std::future<std::size_t> pending_m;
+};
+
+// Writes fixed-width binary records to a file. Records are collected in one
+// of two buffers of half of buffer_records each; a full buffer is written on
+// the io_thread while the other one fills.
+template <class T> class record_writer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "records are stored as their object representation");
+
+public:
+  record_writer(const std::filesystem::path &path, std::size_t buffer_records,
+                io_thread &io)
+      : io_m(io), file_m(path, std::ios::binary | std::ios::trunc),
+        capacity_m(buffer_records > 1 ? buffer_records / 2 : 1) {
+    if (!file_m)
+      throw std::runtime_error("Cannot open " + path.string() +
+                               " for writing.");
+    buffer_m.reserve(capacity_m);
+    writing_m.reserve(capacity_m);
+  }
+  record_writer(const record_writer &) = delete;
+  record_writer &operator=(const record_writer &) = delete;
+  ~record_writer() {
+    try {
+      flush();
+    } catch (...) {
+    }
+    if (pending_m.valid())
+      pending_m.wait();
+  }
+
+  void push(const T &record) {
+    buffer_m.push_back(record);
+    if (buffer_m.size() == capacity_m)
+      write_behind();
+  }
+
+  // Writes count records straight to the file, past the buffers.
+  void append(const T *records, std::size_t count) {
+    write_behind();
+    wait();
+    write_block(records, count);
+  }
+
+  // Writes out the buffered records and waits for the writes in progress;
+  // called by the destructor too, which swallows errors.
+  void flush() {
+    write_behind();
+    wait();
+    file_m.flush();
+    if (!file_m)
+      throw std::runtime_error("Error while writing a record file.");
+  }
+
+  class iterator {
+  public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    explicit iterator(record_writer *writer) : writer_m(writer) {}
+
+    iterator &operator=(const T &record) {
+      writer_m->push(record);
+      return *this;
+    }
+    iterator &operator*() { return *this; }
+    iterator &operator++() { return *this; }
+    iterator &operator++(int) { return *this; }
+
+  private:
+    record_writer *writer_m;
+  };
+
+  iterator out() { return iterator(this); }
+
+private:
+  void write_block(const T *records, std::size_t count) {
+    file_m.write(reinterpret_cast<const char *>(records),
+                 static_cast<std::streamsize>(count * sizeof(T)));
+    if (!file_m)
+      throw std::runtime_error("Error while writing a record file.");
+  }
+
+  // Hands the filled buffer to the io_thread once the previous write has
+  // finished, and continues with the other buffer.
+  void write_behind() {
+    if (buffer_m.empty())
+      return;
+    wait();
+    buffer_m.swap(writing_m);
+    buffer_m.clear();
+    pending_m = io_m.submit(
+        [this] { write_block(writing_m.data(), writing_m.size()); });
+  }
+
+  // Rethrows the error of the write in progress, if it failed.
+  void wait() {
+    if (pending_m.valid())
+      pending_m.get();
+  }
+
+  io_thread &io_m;
+  std::ofstream file_m;
+  std::size_t capacity_m;
+  std::vector<T> buffer_m;
+  std::vector<T> writing_m;
+  std::future<void> pending_m;
+};
+
+// Merges the runs into d_first, fan_in runs at a time. Every pass but the
+// last writes its merged runs to new temporary files, so the number of open
+// files and buffers stays bounded however many runs there are. The blocks
+// of all runs are read and written on io.
+template <class T, class OutputIt, class Compare>
+OutputIt merge_runs(std::vector<temporary_file> runs, OutputIt d_first,
+                    Compare comp, const external_sort_options &options,
+                    io_thread &io) {
+  auto budget_records = options.memory_budget / sizeof(T);
+  auto block = options.min_block_size > sizeof(T) ? options.min_block_size
+                                                  : sizeof(T);
+  auto fan_in = options.memory_budget / (2 * block);
+  fan_in = fan_in > 3 ? fan_in - 1 : 2;
+
+  // Each open run and the output get an equal share of the budget.
+  auto merge_group = [&](auto group_first, auto group_last, auto out) {
+    auto readers_count = static_cast<std::size_t>(group_last - group_first);
+    auto buffer_records = budget_records / (readers_count + 1);
+    std::vector<std::unique_ptr<record_reader<T>>> readers;
+    readers.reserve(readers_count);
+    using range = std::pair<typename record_reader<T>::iterator,
+                            typename record_reader<T>::iterator>;
+    std::vector<range> ranges;
+    for (auto it = group_first; it != group_last; ++it) {
+      readers.push_back(std::make_unique<record_reader<T>>(
+          it->path(), buffer_records, io));
+      ranges.emplace_back(readers.back()->begin(), readers.back()->end());
+    }
+    return STL::merge_k(ranges, out, comp);
+  };
+
+  while (runs.size() > fan_in) {
+    std::vector<temporary_file> merged;
+    for (std::size_t i = 0; i < runs.size(); i += fan_in) {
+      auto group_last = runs.size() - i > fan_in ? i + fan_in : runs.size();
+      if (group_last - i == 1) {
+        merged.push_back(std::move(runs[i]));
+        continue;
+      }
+      merged.emplace_back(options.temp_directory);
+      record_writer<T> writer(merged.back().path(),
+                              budget_records / (group_last - i + 1), io);
+      merge_group(runs.begin() + i, runs.begin() + group_last, writer.out());
+      writer.flush();
+    }
+    runs = std::move(merged);
+  }
+  return merge_group(runs.begin(), runs.end(), d_first);
+}
+
+// Sorts a sequence that need not fit in memory. Runs of at most
+// options.memory_budget bytes are sorted in memory with STL::sort and
+// spilled to temporary files as fixed-width binary records, then merged
+// into d_first through a tournament tree. A sequence that fits in one run is
+// never written to disk. Not stable.
+template <class InputIt, class OutputIt, class Compare>
+OutputIt external_sort(InputIt first, InputIt last, OutputIt d_first,
+                       Compare comp, const external_sort_options &options = {}) {
+  using T = typename std::iterator_traits<InputIt>::value_type;
+  static_assert(std::is_trivially_copyable_v<T>,
+                "external_sort spills records as their object representation");
+
+  auto run_records = options.memory_budget / sizeof(T);
+  if (run_records == 0)
+    run_records = 1;
+
+  std::vector<T> run;
+  run.reserve(run_records);
+  std::vector<temporary_file> runs;
+  // Started with the first run that is spilled.
+  std::optional<io_thread> io;
+  while (true) {
+    for (; first != last && run.size() < run_records; ++first) {
+      run.push_back(*first);
+    }
+    STL::sort(run.begin(), run.end(), comp);
+    if (first == last && runs.empty())
+      return STL::copy(run.begin(), run.end(), d_first);
+    if (!run.empty()) {
+      runs.emplace_back(options.temp_directory);
+      if (!io)
+        io.emplace();
+      record_writer<T> writer(runs.back().path(), 1, *io);
+      writer.append(run.data(), run.size());
+      writer.flush();
+      run.clear();
+    }
+    if (first == last)
+      break;
+  }
+  // Give the run buffer back before the merge takes its share of the budget.
+  std::vector<T>().swap(run);
+  return STL::merge_runs<T>(std::move(runs), d_first, comp, options, *io);
+}
+
+template <class InputIt, class OutputIt>
+OutputIt external_sort(InputIt first, InputIt last, OutputIt d_first,
+                       const external_sort_options &options = {}) {
+  return STL::external_sort(first, last, d_first, std::less<>(), options);
+}
+
+// Sorts the fixed-width binary records of type T in the input file into the
+// output file, which may be the same file. The output is replaced only once
+// the sort has succeeded.
+template <class T, class Compare>
+void external_sort_file(const std::filesystem::path &input,
+                        const std::filesystem::path &output, Compare comp,
+                        const external_sort_options &options = {}) {
+  auto block_records = 2 * (options.min_block_size / sizeof(T));
+  // Staged next to the output so that the final rename stays within one
+  // file system.
+  auto directory = output.parent_path();
+  temporary_file staged(directory.empty() ? std::filesystem::path(".")
+                                          : directory);
+  {
+    io_thread io;
+    record_reader<T> reader(input, block_records, io);
+    record_writer<T> writer(staged.path(), block_records, io);
+    STL::external_sort(reader.begin(), reader.end(), writer.out(), comp,
+                       options);
+    writer.flush();
+  }
+  std::filesystem::rename(staged.path(), output);
+}
+
+template <class T>
+void external_sort_file(const std::filesystem::path &input,
+                        const std::filesystem::path &output,
+                        const external_sort_options &options = {}) {
+  STL::external_sort_file<T>(input, output, std::less<>(), options);
+}
+} // namespace STL
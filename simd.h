@@ -0,0 +1,812 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||          \
+    defined(_M_IX86)
+#define STL_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define STL_SIMD_X86 0
+#endif
+
+// GCC and Clang only emit instructions of an extension inside functions that
+// are compiled for it; MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define STL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define STL_TARGET(isa)
+#endif
+
+namespace STL {
+namespace simd {
+// Instruction set levels the vector kernels are written for, in increasing
+// order. A level implies all the levels below it.
+enum class isa_level { scalar, sse42, avx2, avx512 };
+
+#if STL_SIMD_X86
+inline void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (auto i = 0; i < 4; ++i) {
+    regs[i] = static_cast<unsigned>(info[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the operating system saves on context switches.
+inline std::uint64_t xgetbv() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _xgetbv(0);
+#else
+  unsigned eax, edx;
+  __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+inline isa_level detect_isa_level() {
+#if STL_SIMD_X86
+  unsigned regs[4];
+  cpuid(0, 0, regs);
+  auto max_leaf = regs[0];
+  if (max_leaf < 1)
+    return isa_level::scalar;
+
+  cpuid(1, 0, regs);
+  auto ecx = regs[2];
+  bool sse42 = (ecx >> 20) & 1;
+  bool popcnt = (ecx >> 23) & 1;
+  if (!sse42 || !popcnt)
+    return isa_level::scalar;
+
+  bool osxsave = (ecx >> 27) & 1;
+  bool avx = (ecx >> 28) & 1;
+  if (!osxsave || !avx || max_leaf < 7)
+    return isa_level::sse42;
+  auto xcr0 = xgetbv();
+  if ((xcr0 & 0x6) != 0x6)
+    return isa_level::sse42;
+
+  cpuid(7, 0, regs);
+  auto ebx = regs[1];
+  bool avx2 = (ebx >> 5) & 1;
+  bool bmi2 = (ebx >> 8) & 1;
+  if (!avx2 || !bmi2)
+    return isa_level::sse42;
+
+  bool avx512f = (ebx >> 16) & 1;
+  bool avx512bw = (ebx >> 30) & 1;
+  if (avx512f && avx512bw && (xcr0 & 0xe6) == 0xe6)
+    return isa_level::avx512;
+  return isa_level::avx2;
+#else
+  return isa_level::scalar;
+#endif
+}
+
+// The level supported by the processor, detected once.
+inline isa_level cpu_isa_level() {
+  static const auto level = detect_isa_level();
+  return level;
+}
+
+inline const char *isa_level_name(isa_level level) {
+  switch (level) {
+  case isa_level::sse42:
+    return "sse42";
+  case isa_level::avx2:
+    return "avx2";
+  case isa_level::avx512:
+    return "avx512";
+  case isa_level::scalar:
+    break;
+  }
+  return "scalar";
+}
+
+inline std::optional<isa_level> parse_isa_level(const char *name) {
+  for (auto level : {isa_level::scalar, isa_level::sse42, isa_level::avx2,
+                     isa_level::avx512}) {
+    if (std::strcmp(name, isa_level_name(level)) == 0)
+      return level;
+  }
+  return std::nullopt;
+}
+
+// Level named by the STL_SIMD_LEVEL environment variable, if it is set to
+// one of the names of isa_level_name.
+inline std::optional<isa_level> requested_isa_level() {
+#if defined(_MSC_VER)
+  char *value = nullptr;
+  std::size_t length = 0;
+  if (_dupenv_s(&value, &length, "STL_SIMD_LEVEL") != 0 || !value)
+    return std::nullopt;
+  auto level = parse_isa_level(value);
+  std::free(value);
+  return level;
+#else
+  auto value = std::getenv("STL_SIMD_LEVEL");
+  return value ? parse_isa_level(value) : std::nullopt;
+#endif
+}
+
+// The level the kernels are chosen for: the processor's, or a lower one
+// forced through STL_SIMD_LEVEL so that every code path can be tested on one
+// machine. A forced level above the processor's is ignored. Decided once.
+inline isa_level active_isa_level() {
+  static const auto level = [] {
+    auto detected = cpu_isa_level();
+    auto requested = requested_isa_level();
+    return requested && *requested < detected ? *requested : detected;
+  }();
+  return level;
+}
+
+// The implementations of one vector kernel for each isa_level, nullptr where
+// a level has none. Call sites resolve a table once and keep the pointer;
+// nullptr means the scalar code of the caller runs.
+template <class Fn> struct kernel_table {
+  Fn entries[4] = {};
+
+  constexpr Fn &operator[](isa_level level) {
+    return entries[static_cast<int>(level)];
+  }
+
+  // The kernel of the highest level up to level.
+  constexpr Fn resolve(isa_level level) const {
+    for (auto i = static_cast<int>(level); i >= 0; --i) {
+      if (entries[i])
+        return entries[i];
+    }
+    return nullptr;
+  }
+  Fn resolve() const { return resolve(active_isa_level()); }
+};
+
+// Shuffle controls that move the lanes selected by a compare mask to the
+// front of a vector, plus the number of selected lanes per mask.
+struct compaction_tables {
+  constexpr compaction_tables() {
+    for (auto mask = 0; mask < 256; ++mask) {
+      auto lanes = 0;
+      for (auto lane = 0; lane < 8; ++lane) {
+        if (mask & (1 << lane))
+          epi32x8[mask][lanes++] = static_cast<std::uint32_t>(lane);
+      }
+      popcount[mask] = static_cast<std::uint8_t>(lanes);
+    }
+    for (auto mask = 0; mask < 16; ++mask) {
+      auto lanes = 0;
+      for (auto lane = 0; lane < 4; ++lane) {
+        if (!(mask & (1 << lane)))
+          continue;
+        for (auto byte = 0; byte < 4; ++byte) {
+          epi32x4[mask][lanes * 4 + byte] =
+              static_cast<std::uint8_t>(lane * 4 + byte);
+        }
+        epi64x4[mask][lanes * 2] = static_cast<std::uint32_t>(lane * 2);
+        epi64x4[mask][lanes * 2 + 1] = static_cast<std::uint32_t>(lane * 2 + 1);
+        ++lanes;
+      }
+    }
+    for (auto mask = 0; mask < 4; ++mask) {
+      auto lanes = 0;
+      for (auto lane = 0; lane < 2; ++lane) {
+        if (!(mask & (1 << lane)))
+          continue;
+        for (auto byte = 0; byte < 8; ++byte) {
+          epi64x2[mask][lanes * 8 + byte] =
+              static_cast<std::uint8_t>(lane * 8 + byte);
+        }
+        ++lanes;
+      }
+    }
+  }
+
+  alignas(32) std::uint32_t epi32x8[256][8] = {};
+  alignas(32) std::uint32_t epi64x4[16][8] = {};
+  alignas(16) std::uint8_t epi32x4[16][16] = {};
+  alignas(16) std::uint8_t epi64x2[4][16] = {};
+  std::uint8_t popcount[256] = {};
+};
+
+inline constexpr compaction_tables compaction{};
+
+// Sorted integer intersection kernels. Blocks of both inputs are compared
+// all-pairs (every lane against every rotation of the other block), the
+// matching lanes of a are compacted with a shuffle and stored, and the block
+// with the smaller last element is replaced. The compare only handles
+// strictly increasing inputs, so each block is checked against its
+// neighbour one element on and the kernel stops at a duplicate; it also
+// stops when fewer than a block and one element are left on either side.
+// Up to a full block past the returned count is written to out. Returns the
+// number of matches and stores the elements consumed in *ia and *ib;
+// everything before them is finished and a scalar loop can pick up there.
+template <class T>
+using intersect_kernel = std::size_t (*)(const T *, std::size_t, const T *,
+                                         std::size_t, T *, std::size_t *,
+                                         std::size_t *);
+
+#if STL_SIMD_X86
+template <class T>
+STL_TARGET("sse4.2,popcnt")
+std::size_t intersect_epi32_sse42(const T *a, std::size_t na, const T *b,
+                                  std::size_t nb, T *out, std::size_t *ia,
+                                  std::size_t *ib) {
+  static_assert(sizeof(T) == 4, "32 bit lanes");
+  std::size_t i = 0, j = 0, k = 0;
+  if (na > 4 && nb > 4) {
+    auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    while (true) {
+      auto next_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 1));
+      auto next_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j + 1));
+      if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(va, next_a),
+                                         _mm_cmpeq_epi32(vb, next_b))))
+        break;
+
+      auto eq = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                       _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+          _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4e)),
+                       _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+      auto mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+      auto shuffle = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(compaction.epi32x4[mask]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k),
+                       _mm_shuffle_epi8(va, shuffle));
+      k += compaction.popcount[mask];
+
+      auto a_max = a[i + 3];
+      auto b_max = b[j + 3];
+      if (!(b_max < a_max))
+        i += 4;
+      if (!(a_max < b_max))
+        j += 4;
+      if (i + 4 >= na || j + 4 >= nb)
+        break;
+      va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+      vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+    }
+  }
+  *ia = i;
+  *ib = j;
+  return k;
+}
+
+template <class T>
+STL_TARGET("sse4.2,popcnt")
+std::size_t intersect_epi64_sse42(const T *a, std::size_t na, const T *b,
+                                  std::size_t nb, T *out, std::size_t *ia,
+                                  std::size_t *ib) {
+  static_assert(sizeof(T) == 8, "64 bit lanes");
+  std::size_t i = 0, j = 0, k = 0;
+  if (na > 2 && nb > 2) {
+    auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    while (true) {
+      auto next_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 1));
+      auto next_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j + 1));
+      if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi64(va, next_a),
+                                         _mm_cmpeq_epi64(vb, next_b))))
+        break;
+
+      auto eq = _mm_or_si128(_mm_cmpeq_epi64(va, vb),
+                             _mm_cmpeq_epi64(va, _mm_shuffle_epi32(vb, 0x4e)));
+      auto mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+      auto shuffle = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(compaction.epi64x2[mask]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + k),
+                       _mm_shuffle_epi8(va, shuffle));
+      k += compaction.popcount[mask];
+
+      auto a_max = a[i + 1];
+      auto b_max = b[j + 1];
+      if (!(b_max < a_max))
+        i += 2;
+      if (!(a_max < b_max))
+        j += 2;
+      if (i + 2 >= na || j + 2 >= nb)
+        break;
+      va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+      vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+    }
+  }
+  *ia = i;
+  *ib = j;
+  return k;
+}
+
+template <class T>
+STL_TARGET("avx2,bmi2,popcnt")
+std::size_t intersect_epi32_avx2(const T *a, std::size_t na, const T *b,
+                                 std::size_t nb, T *out, std::size_t *ia,
+                                 std::size_t *ib) {
+  static_assert(sizeof(T) == 4, "32 bit lanes");
+  std::size_t i = 0, j = 0, k = 0;
+  if (na > 8 && nb > 8) {
+    auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+    auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    while (true) {
+      auto next_a =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 1));
+      auto next_b =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j + 1));
+      if (!_mm256_testz_si256(
+              _mm256_or_si256(_mm256_cmpeq_epi32(va, next_a),
+                              _mm256_cmpeq_epi32(vb, next_b)),
+              _mm256_set1_epi32(-1)))
+        break;
+
+      // Rotations within each 128 bit half, then the same for the halves
+      // swapped, cover all eight offsets.
+      auto swapped = _mm256_permute2x128_si256(vb, vb, 0x01);
+      auto eq = _mm256_or_si256(
+          _mm256_or_si256(
+              _mm256_or_si256(_mm256_cmpeq_epi32(va, vb),
+                              _mm256_cmpeq_epi32(
+                                  va, _mm256_shuffle_epi32(vb, 0x39))),
+              _mm256_or_si256(
+                  _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, 0x4e)),
+                  _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, 0x93)))),
+          _mm256_or_si256(
+              _mm256_or_si256(_mm256_cmpeq_epi32(va, swapped),
+                              _mm256_cmpeq_epi32(
+                                  va, _mm256_shuffle_epi32(swapped, 0x39))),
+              _mm256_or_si256(
+                  _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(swapped, 0x4e)),
+                  _mm256_cmpeq_epi32(va,
+                                     _mm256_shuffle_epi32(swapped, 0x93)))));
+      auto mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+      auto permutation = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(compaction.epi32x8[mask]));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k),
+                          _mm256_permutevar8x32_epi32(va, permutation));
+      k += compaction.popcount[mask];
+
+      auto a_max = a[i + 7];
+      auto b_max = b[j + 7];
+      if (!(b_max < a_max))
+        i += 8;
+      if (!(a_max < b_max))
+        j += 8;
+      if (i + 8 >= na || j + 8 >= nb)
+        break;
+      va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+      vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+    }
+  }
+  *ia = i;
+  *ib = j;
+  return k;
+}
+
+template <class T>
+STL_TARGET("avx2,bmi2,popcnt")
+std::size_t intersect_epi64_avx2(const T *a, std::size_t na, const T *b,
+                                 std::size_t nb, T *out, std::size_t *ia,
+                                 std::size_t *ib) {
+  static_assert(sizeof(T) == 8, "64 bit lanes");
+  std::size_t i = 0, j = 0, k = 0;
+  if (na > 4 && nb > 4) {
+    auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+    auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    while (true) {
+      auto next_a =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 1));
+      auto next_b =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j + 1));
+      if (!_mm256_testz_si256(
+              _mm256_or_si256(_mm256_cmpeq_epi64(va, next_a),
+                              _mm256_cmpeq_epi64(vb, next_b)),
+              _mm256_set1_epi32(-1)))
+        break;
+
+      auto eq = _mm256_or_si256(
+          _mm256_or_si256(
+              _mm256_cmpeq_epi64(va, vb),
+              _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x39))),
+          _mm256_or_si256(
+              _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x4e)),
+              _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x93))));
+      auto mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+      auto permutation = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(compaction.epi64x4[mask]));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k),
+                          _mm256_permutevar8x32_epi32(va, permutation));
+      k += compaction.popcount[mask];
+
+      auto a_max = a[i + 3];
+      auto b_max = b[j + 3];
+      if (!(b_max < a_max))
+        i += 4;
+      if (!(a_max < b_max))
+        j += 4;
+      if (i + 4 >= na || j + 4 >= nb)
+        break;
+      va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+      vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+    }
+  }
+  *ia = i;
+  *ib = j;
+  return k;
+}
+#endif
+
+template <class T>
+constexpr kernel_table<intersect_kernel<T>> make_intersect_kernels() {
+  static_assert(std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8),
+                "32 or 64 bit integers only");
+  kernel_table<intersect_kernel<T>> table;
+#if STL_SIMD_X86
+  if constexpr (sizeof(T) == 4) {
+    table[isa_level::sse42] = &intersect_epi32_sse42<T>;
+    table[isa_level::avx2] = &intersect_epi32_avx2<T>;
+  } else {
+    table[isa_level::sse42] = &intersect_epi64_sse42<T>;
+    table[isa_level::avx2] = &intersect_epi64_avx2<T>;
+  }
+#endif
+  return table;
+}
+
+template <class T>
+inline constexpr auto intersect_kernels = make_intersect_kernels<T>();
+
+// Equality scans for find and count over arithmetic lanes of 1, 2, 4 or 8
+// bytes. Every iteration compares four vectors and takes one branch for all
+// of them; what is left after the last full vector is finished by a scalar
+// loop. Floating point lanes compare like operator==, so NaN never matches
+// and -0.0 matches 0.0.
+template <class T> using find_kernel = const T *(*)(const T *, const T *, T);
+template <class T>
+using count_kernel = std::size_t (*)(const T *, const T *, T);
+
+#if STL_SIMD_X86
+inline unsigned trailing_zeros(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// The object representation of value repeated in every lane.
+template <class T> STL_TARGET("sse4.2") __m128i broadcast_sse(T value) {
+  if constexpr (sizeof(T) == 1) {
+    std::int8_t bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return _mm_set1_epi8(bits);
+  } else if constexpr (sizeof(T) == 2) {
+    std::int16_t bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return _mm_set1_epi16(bits);
+  } else if constexpr (sizeof(T) == 4) {
+    std::int32_t bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return _mm_set1_epi32(bits);
+  } else {
+    std::int64_t bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    return _mm_set1_epi64x(bits);
+  }
+}
+
+template <class T>
+STL_TARGET("sse4.2") __m128i equal_lanes_sse(__m128i a, __m128i b) {
+  if constexpr (std::is_same<T, float>::value) {
+    return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a),
+                                         _mm_castsi128_ps(b)));
+  } else if constexpr (std::is_same<T, double>::value) {
+    return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a),
+                                         _mm_castsi128_pd(b)));
+  } else if constexpr (sizeof(T) == 1) {
+    return _mm_cmpeq_epi8(a, b);
+  } else if constexpr (sizeof(T) == 2) {
+    return _mm_cmpeq_epi16(a, b);
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm_cmpeq_epi32(a, b);
+  } else {
+    return _mm_cmpeq_epi64(a, b);
+  }
+}
+
+template <class T>
+STL_TARGET("sse4.2") __m128i equal_lanes_sse(const T *p, __m128i needle) {
+  return equal_lanes_sse<T>(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), needle);
+}
+
+template <class T>
+STL_TARGET("sse4.2,popcnt")
+const T *find_sse42(const T *first, const T *last, T value) {
+  constexpr std::size_t lanes = 16 / sizeof(T);
+  auto needle = broadcast_sse(value);
+  auto n = static_cast<std::size_t>(last - first);
+  std::size_t i = 0;
+  for (; i + 4 * lanes <= n; i += 4 * lanes) {
+    auto e0 = equal_lanes_sse(first + i, needle);
+    auto e1 = equal_lanes_sse(first + i + lanes, needle);
+    auto e2 = equal_lanes_sse(first + i + 2 * lanes, needle);
+    auto e3 = equal_lanes_sse(first + i + 3 * lanes, needle);
+    if (!_mm_movemask_epi8(
+            _mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3))))
+      continue;
+    for (auto e : {e0, e1, e2, e3}) {
+      if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(e)))
+        return first + i + trailing_zeros(mask) / sizeof(T);
+      i += lanes;
+    }
+  }
+  for (; i + lanes <= n; i += lanes) {
+    if (auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(equal_lanes_sse(first + i, needle))))
+      return first + i + trailing_zeros(mask) / sizeof(T);
+  }
+  for (; i < n; ++i) {
+    if (first[i] == value)
+      return first + i;
+  }
+  return last;
+}
+
+template <class T>
+STL_TARGET("sse4.2,popcnt")
+std::size_t count_sse42(const T *first, const T *last, T value) {
+  constexpr std::size_t lanes = 16 / sizeof(T);
+  auto needle = broadcast_sse(value);
+  auto n = static_cast<std::size_t>(last - first);
+  // Matching lanes set sizeof(T) bits each in the byte masks.
+  std::size_t bits = 0;
+  std::size_t i = 0;
+  for (; i + 4 * lanes <= n; i += 4 * lanes) {
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm_movemask_epi8(equal_lanes_sse(first + i, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm_movemask_epi8(equal_lanes_sse(first + i + lanes, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm_movemask_epi8(equal_lanes_sse(first + i + 2 * lanes, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm_movemask_epi8(equal_lanes_sse(first + i + 3 * lanes, needle))));
+  }
+  for (; i + lanes <= n; i += lanes) {
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm_movemask_epi8(equal_lanes_sse(first + i, needle))));
+  }
+  auto count = bits / sizeof(T);
+  for (; i < n; ++i) {
+    count += first[i] == value;
+  }
+  return count;
+}
+
+template <class T>
+STL_TARGET("avx2") __m256i equal_lanes_avx2(const T *p, __m256i needle) {
+  auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  if constexpr (std::is_same<T, float>::value) {
+    return _mm256_castps_si256(_mm256_cmp_ps(
+        _mm256_castsi256_ps(a), _mm256_castsi256_ps(needle), _CMP_EQ_OQ));
+  } else if constexpr (std::is_same<T, double>::value) {
+    return _mm256_castpd_si256(_mm256_cmp_pd(
+        _mm256_castsi256_pd(a), _mm256_castsi256_pd(needle), _CMP_EQ_OQ));
+  } else if constexpr (sizeof(T) == 1) {
+    return _mm256_cmpeq_epi8(a, needle);
+  } else if constexpr (sizeof(T) == 2) {
+    return _mm256_cmpeq_epi16(a, needle);
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm256_cmpeq_epi32(a, needle);
+  } else {
+    return _mm256_cmpeq_epi64(a, needle);
+  }
+}
+
+template <class T>
+STL_TARGET("avx2,bmi2,popcnt")
+const T *find_avx2(const T *first, const T *last, T value) {
+  constexpr std::size_t lanes = 32 / sizeof(T);
+  auto needle = _mm256_broadcastsi128_si256(broadcast_sse(value));
+  auto n = static_cast<std::size_t>(last - first);
+  std::size_t i = 0;
+  for (; i + 4 * lanes <= n; i += 4 * lanes) {
+    auto e0 = equal_lanes_avx2(first + i, needle);
+    auto e1 = equal_lanes_avx2(first + i + lanes, needle);
+    auto e2 = equal_lanes_avx2(first + i + 2 * lanes, needle);
+    auto e3 = equal_lanes_avx2(first + i + 3 * lanes, needle);
+    if (_mm256_testz_si256(_mm256_or_si256(_mm256_or_si256(e0, e1),
+                                           _mm256_or_si256(e2, e3)),
+                           _mm256_set1_epi8(-1)))
+      continue;
+    for (auto e : {e0, e1, e2, e3}) {
+      if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(e)))
+        return first + i + trailing_zeros(mask) / sizeof(T);
+      i += lanes;
+    }
+  }
+  for (; i + lanes <= n; i += lanes) {
+    if (auto mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(equal_lanes_avx2(first + i, needle))))
+      return first + i + trailing_zeros(mask) / sizeof(T);
+  }
+  for (; i < n; ++i) {
+    if (first[i] == value)
+      return first + i;
+  }
+  return last;
+}
+
+template <class T>
+STL_TARGET("avx2,bmi2,popcnt")
+std::size_t count_avx2(const T *first, const T *last, T value) {
+  constexpr std::size_t lanes = 32 / sizeof(T);
+  auto needle = _mm256_broadcastsi128_si256(broadcast_sse(value));
+  auto n = static_cast<std::size_t>(last - first);
+  std::size_t bits = 0;
+  std::size_t i = 0;
+  for (; i + 4 * lanes <= n; i += 4 * lanes) {
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm256_movemask_epi8(equal_lanes_avx2(first + i, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm256_movemask_epi8(equal_lanes_avx2(first + i + lanes, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(
+        equal_lanes_avx2(first + i + 2 * lanes, needle))));
+    bits += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(
+        equal_lanes_avx2(first + i + 3 * lanes, needle))));
+  }
+  for (; i + lanes <= n; i += lanes) {
+    bits += _mm_popcnt_u32(static_cast<unsigned>(
+        _mm256_movemask_epi8(equal_lanes_avx2(first + i, needle))));
+  }
+  auto count = bits / sizeof(T);
+  for (; i < n; ++i) {
+    count += first[i] == value;
+  }
+  return count;
+}
+#endif
+
+template <class T> constexpr void check_scan_lanes() {
+  static_assert(std::is_arithmetic<T>::value &&
+                    (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 ||
+                     sizeof(T) == 8),
+                "arithmetic lanes of 1, 2, 4 or 8 bytes only");
+}
+
+template <class T> constexpr kernel_table<find_kernel<T>> make_find_kernels() {
+  check_scan_lanes<T>();
+  kernel_table<find_kernel<T>> table;
+#if STL_SIMD_X86
+  table[isa_level::sse42] = &find_sse42<T>;
+  table[isa_level::avx2] = &find_avx2<T>;
+#endif
+  return table;
+}
+
+template <class T>
+constexpr kernel_table<count_kernel<T>> make_count_kernels() {
+  check_scan_lanes<T>();
+  kernel_table<count_kernel<T>> table;
+#if STL_SIMD_X86
+  table[isa_level::sse42] = &count_sse42<T>;
+  table[isa_level::avx2] = &count_avx2<T>;
+#endif
+  return table;
+}
+
+template <class T>
+inline constexpr auto find_kernels = make_find_kernels<T>();
+template <class T>
+inline constexpr auto count_kernels = make_count_kernels<T>();
+
+// Index of the first byte at which two buffers of n bytes differ, n if they
+// are equal. Four vectors are compared per iteration, as in the scans.
+using mismatch_kernel = std::size_t (*)(const void *, const void *,
+                                        std::size_t);
+
+#if STL_SIMD_X86
+inline STL_TARGET("sse4.2") __m128i
+    equal_bytes_sse(const unsigned char *p, const unsigned char *q) {
+  return _mm_cmpeq_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(q)));
+}
+
+inline STL_TARGET("avx2") __m256i
+    equal_bytes_avx2(const unsigned char *p, const unsigned char *q) {
+  return _mm256_cmpeq_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(q)));
+}
+
+inline STL_TARGET("sse4.2") std::size_t
+    mismatch_sse42(const void *a, const void *b, std::size_t n) {
+  auto p = static_cast<const unsigned char *>(a);
+  auto q = static_cast<const unsigned char *>(b);
+  std::size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    auto e0 = equal_bytes_sse(p + i, q + i);
+    auto e1 = equal_bytes_sse(p + i + 16, q + i + 16);
+    auto e2 = equal_bytes_sse(p + i + 32, q + i + 32);
+    auto e3 = equal_bytes_sse(p + i + 48, q + i + 48);
+    if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(e0, e1),
+                                        _mm_and_si128(e2, e3))) == 0xffff)
+      continue;
+    for (auto e : {e0, e1, e2, e3}) {
+      if (auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(e)) & 0xffffu)
+        return i + trailing_zeros(mask);
+      i += 16;
+    }
+  }
+  for (; i + 16 <= n; i += 16) {
+    auto e = equal_bytes_sse(p + i, q + i);
+    if (auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(e)) & 0xffffu)
+      return i + trailing_zeros(mask);
+  }
+  for (; i < n; ++i) {
+    if (p[i] != q[i])
+      return i;
+  }
+  return n;
+}
+
+inline STL_TARGET("avx2,bmi2") std::size_t
+    mismatch_avx2(const void *a, const void *b, std::size_t n) {
+  auto p = static_cast<const unsigned char *>(a);
+  auto q = static_cast<const unsigned char *>(b);
+  std::size_t i = 0;
+  for (; i + 128 <= n; i += 128) {
+    auto e0 = equal_bytes_avx2(p + i, q + i);
+    auto e1 = equal_bytes_avx2(p + i + 32, q + i + 32);
+    auto e2 = equal_bytes_avx2(p + i + 64, q + i + 64);
+    auto e3 = equal_bytes_avx2(p + i + 96, q + i + 96);
+    if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3)))) == ~0u)
+      continue;
+    for (auto e : {e0, e1, e2, e3}) {
+      if (auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(e)))
+        return i + trailing_zeros(mask);
+      i += 32;
+    }
+  }
+  for (; i + 32 <= n; i += 32) {
+    auto e = equal_bytes_avx2(p + i, q + i);
+    if (auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(e)))
+      return i + trailing_zeros(mask);
+  }
+  for (; i < n; ++i) {
+    if (p[i] != q[i])
+      return i;
+  }
+  return n;
+}
+#endif
+
+constexpr kernel_table<mismatch_kernel> make_mismatch_kernels() {
+  kernel_table<mismatch_kernel> table;
+#if STL_SIMD_X86
+  table[isa_level::sse42] = &mismatch_sse42;
+  table[isa_level::avx2] = &mismatch_avx2;
+#endif
+  return table;
+}
+
+inline constexpr auto mismatch_kernels = make_mismatch_kernels();
+} // namespace simd
+} // namespace STL